@@ -20,6 +20,7 @@ ChessApp::ChessApp() : config("Chess")
 	this->playerType[0] = PlayerType::HUMAN;
 	this->playerType[1] = PlayerType::HUMAN;
 	this->bot = new ChessMinimaxBot();
+	this->ponder = true;
 	dynamic_cast<ChessBotInterface*>(this->bot)->SetDifficulty(ChessBotInterface::Difficulty::MEDIUM);
 }
 
@@ -75,6 +76,7 @@ ChessApp::ChessApp() : config("Chess")
 	}
 
 	this->sound->enabled = this->config.ReadBool("soundFX", false);
+	this->ponder = this->config.ReadBool("ponder", true);
 
 	this->playerType[0] = (PlayerType)this->config.ReadLong("playerType[0]", long(PlayerType::HUMAN));
 	this->playerType[1] = (PlayerType)this->config.ReadLong("playerType[1]", long(PlayerType::HUMAN));
@@ -87,6 +89,7 @@ ChessApp::ChessApp() : config("Chess")
 /*virtual*/ int ChessApp::OnExit(void)
 {
 	this->config.Write("soundFX", this->sound->enabled);
+	this->config.Write("ponder", this->ponder);
 
 	long pt = (long)this->playerType[0];
 	this->config.Write("playerType[0]", pt);
@@ -41,6 +41,7 @@ public:
 	ChessEngine::ChessGame* game;
 	ChessEngine::ChessColor whoseTurn;
 	ChessEngine::ChessAI* bot;
+	bool ponder;
 	PlayerType playerType[2];
 	wxConfig config;
 };
@@ -2,59 +2,6 @@
 #include "ChessApp.h"
 #include "ChessFrame.h"
 
-//---------------------------------------- ChessBotProgressIndicator ----------------------------------------
-
-ChessBotProgressIndicator::ChessBotProgressIndicator()
-{
-	this->startTimeTicks = 0;
-	this->dialogTimeoutSeconds = 2.0;
-	this->progressDialog = nullptr;
-}
-
-/*virtual*/ ChessBotProgressIndicator::~ChessBotProgressIndicator()
-{
-}
-
-/*virtual*/ void ChessBotProgressIndicator::ProgressBegin()
-{
-	this->startTimeTicks = ::clock();
-	wxGetApp().frame->gaugeBar->SetValue(0);
-}
-
-/*virtual*/ bool ChessBotProgressIndicator::ProgressUpdate(float alpha)
-{
-	wxGetApp().frame->gaugeBar->SetValue((int)::roundf(alpha * float(wxGetApp().frame->gaugeBar->GetRange())));
-
-	if (!this->progressDialog)
-	{
-		clock_t currentTimeTicks = ::clock();
-		clock_t elapsedTimeTicks = currentTimeTicks - this->startTimeTicks;
-		double elapsedTimeSeconds = double(elapsedTimeTicks) / double(CLOCKS_PER_SEC);
-		if (elapsedTimeSeconds > this->dialogTimeoutSeconds)
-		{
-			this->progressDialog = new wxProgressDialog("Chess AI", "Thinking...", 100, wxGetApp().frame, wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_CAN_ABORT);
-			this->progressDialog->SetPosition(wxGetApp().frame->GetPosition());
-		}
-	}
-
-	bool keepGoing = true;
-	if (this->progressDialog)
-		keepGoing = this->progressDialog->Update((int)::roundf(alpha * float(this->progressDialog->GetRange())));
-
-	return keepGoing;
-}
-
-/*virtual*/ void ChessBotProgressIndicator::ProgressEnd()
-{
-	wxGetApp().frame->gaugeBar->SetValue(0);
-
-	if (this->progressDialog)
-	{
-		delete this->progressDialog;
-		this->progressDialog = nullptr;
-	}
-}
-
 //---------------------------------------- ChessBotInterface ----------------------------------------
 
 ChessBotInterface::ChessBotInterface()
@@ -80,14 +27,15 @@ ChessBotInterface::ChessBotInterface()
 
 ChessMinimaxBot::ChessMinimaxBot() : ChessEngine::ChessMinimaxAI(1)
 {
-	this->progressIndicator = new ChessBotProgressIndicator();
 }
 
 /*virtual*/ ChessMinimaxBot::~ChessMinimaxBot()
 {
-	delete this->progressIndicator;
 }
 
+// Each level is defined by a budget of nodes, so that it costs about the same no matter the position.  The
+// depth cap and evaluation noise are what make the lower levels weaker, as opposed to just slower.  The time
+// cap is just a backstop.
 /*virtual*/ void ChessMinimaxBot::SetDifficulty(Difficulty difficulty)
 {
 	ChessBotInterface::SetDifficulty(difficulty);
@@ -96,17 +44,26 @@ ChessMinimaxBot::ChessMinimaxBot() : ChessEngine::ChessMinimaxAI(1)
 	{
 		case Difficulty::EASY:
 		{
-			this->maxDepth = 2;
+			this->maxDepth = 3;
+			this->evaluationNoise = 8;
+			this->searchLimits.maxNodes = 5000;
+			this->searchLimits.maxTimeSeconds = 5.0;
 			break;
 		}
 		case Difficulty::MEDIUM:
 		{
-			this->maxDepth = 3;
+			this->maxDepth = 4;
+			this->evaluationNoise = 3;
+			this->searchLimits.maxNodes = 40000;
+			this->searchLimits.maxTimeSeconds = 10.0;
 			break;
 		}
 		case Difficulty::HARD:
 		{
-			this->maxDepth = 4;
+			this->maxDepth = 6;
+			this->evaluationNoise = 0;
+			this->searchLimits.maxNodes = 250000;
+			this->searchLimits.maxTimeSeconds = 15.0;
 			break;
 		}
 	}
@@ -116,14 +73,16 @@ ChessMinimaxBot::ChessMinimaxBot() : ChessEngine::ChessMinimaxAI(1)
 
 ChessMCTSBot::ChessMCTSBot() : ChessEngine::ChessMonteCarloTreeSearchAI(0.0, 0)
 {
-	this->progressIndicator = new ChessBotProgressIndicator();
+	// With so few iterations, each move gets next to no visits of its own, so RAVE makes a big difference.
+	this->raveEquivalence = 100.0;
 }
 
 /*virtual*/ ChessMCTSBot::~ChessMCTSBot()
 {
-	delete this->progressIndicator;
 }
 
+// Here, a node is a whole iteration, and what makes an iteration expensive is how long the random games go
+// on for, so that's capped too.
 /*virtual*/ void ChessMCTSBot::SetDifficulty(Difficulty difficulty)
 {
 	ChessBotInterface::SetDifficulty(difficulty);
@@ -132,20 +91,23 @@ ChessMCTSBot::ChessMCTSBot() : ChessEngine::ChessMonteCarloTreeSearchAI(0.0, 0)
 	{
 		case Difficulty::EASY:
 		{
-			//this->maxTimeSeconds = 10.0;
-			this->maxIterations = 30;
+			this->searchLimits.maxNodes = 30;
+			this->searchLimits.maxTimeSeconds = 10.0;
+			this->maxRolloutMoves = 100;
 			break;
 		}
 		case Difficulty::MEDIUM:
 		{
-			//this->maxTimeSeconds = 20.0;
-			this->maxIterations = 40;
+			this->searchLimits.maxNodes = 40;
+			this->searchLimits.maxTimeSeconds = 20.0;
+			this->maxRolloutMoves = 150;
 			break;
 		}
 		case Difficulty::HARD:
 		{
-			//this->maxTimeSeconds = 30.0;
-			this->maxIterations = 50;
+			this->searchLimits.maxNodes = 50;
+			this->searchLimits.maxTimeSeconds = 30.0;
+			this->maxRolloutMoves = 200;
 			break;
 		}
 	}
@@ -1,24 +1,9 @@
 #pragma once
 
 #include "ChessAI.h"
-#include <wx/progdlg.h>
-#include <time.h>
-
-class ChessBotProgressIndicator : public ChessEngine::ChessAIProgressIndicator
-{
-public:
-	ChessBotProgressIndicator();
-	virtual ~ChessBotProgressIndicator();
-
-	virtual bool ProgressUpdate(float alpha) override;
-	virtual void ProgressBegin() override;
-	virtual void ProgressEnd() override;
-
-	clock_t startTimeTicks;
-	double dialogTimeoutSeconds;
-	wxProgressDialog* progressDialog;
-};
 
+// Note that the bots are run through the non-blocking search API (see ChessFrame::ComputerTakesTurn),
+// so they don't install a progress indicator; that would get called from the search thread.
 class ChessBotInterface
 {
 public:
@@ -35,6 +35,7 @@ ChessFrame::ChessFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size)
 	optionsMenu->Append(new wxMenuItem(optionsMenu, ID_ComputerDifficultyEasy, "Computer Difficulty Easy", "Make the AI dumb.", wxITEM_CHECK));
 	optionsMenu->Append(new wxMenuItem(optionsMenu, ID_ComputerDifficultyMedium, "Computer Difficulty Medium", "Make the AI somewhat smart.", wxITEM_CHECK));
 	optionsMenu->Append(new wxMenuItem(optionsMenu, ID_ComputerDifficultyHard, "Computer Difficulty Hard", "Make the AI as smart as it can be.", wxITEM_CHECK));
+	optionsMenu->Append(new wxMenuItem(optionsMenu, ID_Ponder, "Computer Thinks On Your Time", "Let the computer think about its next move while you think about yours.", wxITEM_CHECK));
 #if 0		// Don't expose these options while MCTS is just a complete failure.
 	optionsMenu->AppendSeparator();
 	optionsMenu->Append(new wxMenuItem(optionsMenu, ID_ComputerTypeMinimax, "Computer Type Minimax", "Have the computer use the Minimax algorithm.", wxITEM_CHECK));
@@ -103,6 +104,7 @@ ChessFrame::ChessFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size)
 	this->Bind(wxEVT_MENU, &ChessFrame::OnComputerDifficulty, this, ID_ComputerDifficultyEasy);
 	this->Bind(wxEVT_MENU, &ChessFrame::OnComputerDifficulty, this, ID_ComputerDifficultyMedium);
 	this->Bind(wxEVT_MENU, &ChessFrame::OnComputerDifficulty, this, ID_ComputerDifficultyHard);
+	this->Bind(wxEVT_MENU, &ChessFrame::OnTogglePonder, this, ID_Ponder);
 	this->Bind(wxEVT_MENU, &ChessFrame::OnComputerType, this, ID_ComputerTypeMinimax);
 	this->Bind(wxEVT_MENU, &ChessFrame::OnComputerType, this, ID_ComputerTypeMCTS);
 	this->Bind(wxEVT_MENU, &ChessFrame::OnDrawCoordinates, this, ID_DrawCoordinates);
@@ -120,6 +122,7 @@ ChessFrame::ChessFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size)
 	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_ComputerDifficultyEasy);
 	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_ComputerDifficultyMedium);
 	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_ComputerDifficultyHard);
+	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_Ponder);
 	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_ComputerTypeMinimax);
 	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_ComputerTypeMCTS);
 	this->Bind(wxEVT_UPDATE_UI, &ChessFrame::OnUpdateMenuItemUI, this, ID_DrawCoordinates);
@@ -167,11 +170,16 @@ ChessFrame::ChessFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size)
 	this->UpdatePanel();
 
 	this->inTimerTick = false;
+	this->searchHandle = nullptr;
+	this->ponderHandle = nullptr;
+	this->ponderNumMoves = 0;
 	this->timer.Start(60);
 }
 
 /*virtual*/ ChessFrame::~ChessFrame()
 {
+	this->AbortComputerTurn();
+
 	ChessEngine::DeleteMoveArray(this->redoMoveArray);
 }
 
@@ -180,8 +188,17 @@ void ChessFrame::OnToggleSoundFX(wxCommandEvent& event)
 	wxGetApp().sound->enabled = !wxGetApp().sound->enabled;
 }
 
+void ChessFrame::OnTogglePonder(wxCommandEvent& event)
+{
+	this->AbortComputerTurn();
+
+	wxGetApp().ponder = !wxGetApp().ponder;
+}
+
 void ChessFrame::OnDoubleUndoRedo(wxCommandEvent& event)
 {
+	this->AbortComputerTurn();
+
 	int numMoves = wxGetApp().game->GetNumMoves();
 
 	wxCommandEvent stateChangedEvent(EVT_GAME_STATE_CHANGED);
@@ -267,10 +284,14 @@ void ChessFrame::OnLoadGame(wxCommandEvent& event)
 	wxFileDialog fileDialog(this, "Choose a Chess file to open.", wxEmptyString, wxEmptyString, "Chess Files (*.chess)|*.chess", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 	if (wxID_OK == fileDialog.ShowModal())
 	{
+		this->AbortComputerTurn();
+
 		if (!wxGetApp().LoadGame(fileDialog.GetPath()))
 			wxMessageBox(wxString::Format("Failed to open game file: %s", (const char*)fileDialog.GetPath().c_str()), "Error", wxICON_ERROR | wxOK, this);
 		else
 		{
+			wxGetApp().bot->NewGame();
+
 			wxCommandEvent stateChangedEvent(EVT_GAME_STATE_CHANGED);
 			wxPostEvent(this, stateChangedEvent);
 
@@ -284,6 +305,8 @@ void ChessFrame::OnUndo(wxCommandEvent& event)
 	ChessEngine::ChessGame* game = wxGetApp().game;
 	if (game->GetNumMoves() > 0)
 	{
+		this->AbortComputerTurn();
+
 		wxGetApp().SetPlayerType(ChessEngine::ChessColor::White, ChessApp::PlayerType::HUMAN);
 		wxGetApp().SetPlayerType(ChessEngine::ChessColor::Black, ChessApp::PlayerType::HUMAN);
 
@@ -304,6 +327,8 @@ void ChessFrame::OnRedo(wxCommandEvent& event)
 {
 	if (this->redoMoveArray.size() > 0)
 	{
+		this->AbortComputerTurn();
+
 		wxGetApp().SetPlayerType(ChessEngine::ChessColor::White, ChessApp::PlayerType::HUMAN);
 		wxGetApp().SetPlayerType(ChessEngine::ChessColor::Black, ChessApp::PlayerType::HUMAN);
 
@@ -374,6 +399,11 @@ void ChessFrame::OnUpdateMenuItemUI(wxUpdateUIEvent& event)
 			event.Check(dynamic_cast<ChessBotInterface*>(wxGetApp().bot)->GetDifficulty() == ChessBotInterface::Difficulty::HARD);
 			break;
 		}
+		case ID_Ponder:
+		{
+			event.Check(wxGetApp().ponder);
+			break;
+		}
 		case ID_ComputerTypeMinimax:
 		{
 			event.Check(dynamic_cast<ChessMinimaxBot*>(wxGetApp().bot) ? true : false);
@@ -456,9 +486,52 @@ void ChessFrame::OnDrawVisibilityArrows(wxCommandEvent& event)
 	this->canvas->SetDrawVisibilityArrows(!this->canvas->GetDrawVisibilityArrows());
 }
 
+// The bot thinks on its own thread so that the UI stays responsive.  We kick off the search on
+// the first call here, and then just keep polling it from the timer until it's done.
 void ChessFrame::ComputerTakesTurn()
 {
-	ChessEngine::ChessMove* move = wxGetApp().bot->CalculateRecommendedMove(wxGetApp().whoseTurn, wxGetApp().game);
+	if (!this->searchHandle)
+	{
+		ChessEngine::ChessGame* game = wxGetApp().game;
+
+		// If we were pondering and the opponent played what we expected, then we've got a head start.
+		if (this->ponderHandle)
+		{
+			const ChessEngine::ChessMove* lastMove = game->GetMove(game->GetNumMoves() - 1);
+			if (game->GetNumMoves() == this->ponderNumMoves + 1 && lastMove && lastMove->Pack() == this->ponderHandle->GetPonderMove())
+			{
+				this->searchHandle = this->ponderHandle;
+				this->ponderHandle = nullptr;
+				this->searchHandle->PonderHit();
+				return;
+			}
+
+			delete this->ponderHandle;
+			this->ponderHandle = nullptr;
+		}
+
+		ChessEngine::ChessAI* bot = wxGetApp().bot;
+		this->searchHandle = bot->StartSearch(wxGetApp().whoseTurn, game, bot->searchLimits);
+		this->gaugeBar->SetValue(0);
+		return;
+	}
+
+	if (!this->searchHandle->IsComplete())
+	{
+		ChessEngine::ChessAI::SearchResult result;
+		this->searchHandle->GetResult(result);
+		this->gaugeBar->SetValue((int)::roundf(result.progress * float(this->gaugeBar->GetRange())));
+		return;
+	}
+
+	ChessEngine::ChessAI::SearchResult result;
+	this->searchHandle->GetResult(result);
+
+	ChessEngine::ChessMove* move = this->searchHandle->TakeBestMove();
+	delete this->searchHandle;
+	this->searchHandle = nullptr;
+	this->gaugeBar->SetValue(0);
+
 	if (!move)
 	{
 		wxGetApp().SetPlayerType(ChessEngine::ChessColor::White, ChessApp::PlayerType::HUMAN);
@@ -471,6 +544,9 @@ void ChessFrame::ComputerTakesTurn()
 		wxGetApp().game->PushMove(move);
 		wxGetApp().FlipTurn();
 
+		if (wxGetApp().ponder && wxGetApp().GetCurrentPlayerType() == ChessApp::PlayerType::HUMAN)
+			this->StartPondering(result.ponderMove);
+
 		wxCommandEvent stateChangedEvent(EVT_GAME_STATE_CHANGED);
 		wxPostEvent(wxGetApp().frame, stateChangedEvent);
 
@@ -478,6 +554,35 @@ void ChessFrame::ComputerTakesTurn()
 	}
 }
 
+// While the human thinks, have the bot think about its next move, assuming the human plays what it expects.
+void ChessFrame::StartPondering(ChessEngine::ChessPackedMove predictedReply)
+{
+	if (predictedReply == CHESS_PACKED_MOVE_NONE)
+		return;
+
+	ChessEngine::ChessAI* bot = wxGetApp().bot;
+	ChessEngine::ChessColor botColor = (wxGetApp().whoseTurn == ChessEngine::ChessColor::White) ? ChessEngine::ChessColor::Black : ChessEngine::ChessColor::White;
+	this->ponderHandle = bot->StartPonder(botColor, wxGetApp().game, predictedReply, bot->searchLimits);
+	this->ponderNumMoves = wxGetApp().game->GetNumMoves();
+}
+
+void ChessFrame::AbortComputerTurn()
+{
+	if (this->searchHandle)
+	{
+		// This stops the search and waits for the thread to bail out, which should be quick.
+		delete this->searchHandle;
+		this->searchHandle = nullptr;
+		this->gaugeBar->SetValue(0);
+	}
+
+	if (this->ponderHandle)
+	{
+		delete this->ponderHandle;
+		this->ponderHandle = nullptr;
+	}
+}
+
 void ChessFrame::UpdateStatusBar()
 {
 	wxString text;
@@ -521,8 +626,11 @@ void ChessFrame::UpdatePanel()
 
 void ChessFrame::OnNewGame(wxCommandEvent& event)
 {
+	this->AbortComputerTurn();
+
 	wxGetApp().game->Reset();
 	wxGetApp().whoseTurn = ChessEngine::ChessColor::White;
+	wxGetApp().bot->NewGame();
 
 	wxCommandEvent stateChangedEvent(EVT_GAME_STATE_CHANGED);
 	wxPostEvent(this, stateChangedEvent);
@@ -551,6 +659,8 @@ void ChessFrame::OnColorPlayerdByComputer(wxCommandEvent& event)
 		}
 	}
 
+	this->AbortComputerTurn();
+
 	ChessApp::PlayerType playerType = wxGetApp().GetPlayerType(color);
 
 	if (playerType == ChessApp::PlayerType::HUMAN)
@@ -566,6 +676,9 @@ void ChessFrame::OnColorPlayerdByComputer(wxCommandEvent& event)
 
 void ChessFrame::OnComputerDifficulty(wxCommandEvent& event)
 {
+	// The knobs changed here are read by the search thread, so don't change them out from under it.
+	this->AbortComputerTurn();
+
 	switch (event.GetId())
 	{
 		case ID_ComputerDifficultyEasy:
@@ -588,6 +701,8 @@ void ChessFrame::OnComputerDifficulty(wxCommandEvent& event)
 
 void ChessFrame::OnComputerType(wxCommandEvent& event)
 {
+	this->AbortComputerTurn();
+
 	switch (event.GetId())
 	{
 		case ID_ComputerTypeMinimax:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ChessCommon.h>
+#include <ChessAI.h>
 #include <wx/frame.h>
 #include <wx/listbox.h>
 #include <wx/button.h>
@@ -36,6 +37,7 @@ public:
 	void OnHowToPlay(wxCommandEvent& event);
 	void OnDoubleUndoRedo(wxCommandEvent& event);
 	void OnToggleSoundFX(wxCommandEvent& event);
+	void OnTogglePonder(wxCommandEvent& event);
 
 	enum
 	{
@@ -50,6 +52,7 @@ public:
 		ID_ComputerDifficultyEasy,
 		ID_ComputerDifficultyMedium,
 		ID_ComputerDifficultyHard,
+		ID_Ponder,
 		ID_ComputerTypeMinimax,
 		ID_ComputerTypeMCTS,
 		ID_DrawCoordinates,
@@ -66,6 +69,8 @@ public:
 	void UpdateStatusBar();
 	void UpdatePanel();
 	void ComputerTakesTurn();
+	void AbortComputerTurn();
+	void StartPondering(ChessEngine::ChessPackedMove predictedReply);
 
 	ChessCanvas* canvas;
 	wxListBox* moveListBox;
@@ -75,4 +80,7 @@ public:
 	ChessEngine::ChessMoveArray redoMoveArray;
 	wxTimer timer;
 	bool inTimerTick;
+	ChessEngine::ChessAI::SearchHandle* searchHandle;
+	ChessEngine::ChessAI::SearchHandle* ponderHandle;
+	int ponderNumMoves;
 };
\ No newline at end of file
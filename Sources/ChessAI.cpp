@@ -2,6 +2,8 @@
 #include "ChessGame.h"
 #include "ChessPiece.h"
 #include "ChessMove.h"
+#include "ChessThreadPool.h"
+#include "ChessPlayout.h"
 #include <algorithm>
 #include <cstdlib>
 #include <time.h>
@@ -11,6 +13,9 @@
 
 using namespace ChessEngine;
 
+// The handle whose completion callback is running on this thread, if any.
+static thread_local const ChessAI::SearchHandle* completingHandle = nullptr;
+
 //---------------------------------------- ProgressIndicator ----------------------------------------
 
 ChessAIProgressIndicator::ChessAIProgressIndicator()
@@ -39,9 +44,334 @@ ChessAIProgressIndicator::ChessAIProgressIndicator()
 ChessAI::ChessAI()
 {
 	this->progressIndicator = nullptr;
+	this->searchStopped = false;
+	this->nodeCount = 0;
+	this->clockPollInterval = 1;
+	this->nextClockPollNodeCount = 0;
+	this->nodeBudgetStartCount = 0;
+	this->activeSearch = nullptr;
 }
 
 /*virtual*/ ChessAI::~ChessAI()
+{
+	// The search thread is using us, so it must not outlive us.
+	assert(this->activeSearch.load(std::memory_order_acquire) == nullptr);
+}
+
+ChessAI::SearchHandle* ChessAI::StartSearch(ChessColor favoredColor, const ChessGame* game, const SearchLimits& limits, SearchHandle::CompletionCallback completionCallback /*= nullptr*/)
+{
+	if (this->activeSearch.load(std::memory_order_acquire))
+		return nullptr;
+
+	return this->LaunchSearch(favoredColor, game->Clone(), limits, completionCallback);
+}
+
+ChessAI::SearchHandle* ChessAI::StartPonder(ChessColor favoredColor, const ChessGame* game, ChessPackedMove predictedReply, const SearchLimits& limits, SearchHandle::CompletionCallback completionCallback /*= nullptr*/)
+{
+	if (this->activeSearch.load(std::memory_order_acquire))
+		return nullptr;
+
+	ChessGame* ponderGame = game->Clone();
+	ChessColor opponentColor = (favoredColor == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+	ChessMove* reply = ponderGame->UnpackMove(opponentColor, predictedReply);
+	if (!reply)
+	{
+		delete ponderGame;
+		return nullptr;
+	}
+
+	ponderGame->PushMove(reply);
+
+	SearchLimits ponderLimits = limits;
+	ponderLimits.ponder = true;
+
+	SearchHandle* handle = this->LaunchSearch(favoredColor, ponderGame, ponderLimits, completionCallback);
+	if (handle)
+		handle->ponderMove = predictedReply;
+
+	return handle;
+}
+
+ChessAI::SearchHandle* ChessAI::LaunchSearch(ChessColor favoredColor, ChessGame* game, const SearchLimits& limits, SearchHandle::CompletionCallback completionCallback)
+{
+	SearchHandle* handle = new SearchHandle(this, favoredColor, game, completionCallback);
+
+	// The check in StartSearch() was only a quick out.  Two callers could both have gotten past it, so it's
+	// this that decides which of them gets the AI.
+	SearchHandle* noSearch = nullptr;
+	if (!this->activeSearch.compare_exchange_strong(noSearch, handle, std::memory_order_acq_rel, std::memory_order_acquire))
+	{
+		delete handle;
+		return nullptr;
+	}
+
+	this->searchLimits = limits;
+
+	{
+		MutexLocker locker(this->resultMutex);
+		this->latestResult = SearchResult();
+	}
+
+	if (!handle->thread.SpawnThread())
+	{
+		this->activeSearch.store(nullptr, std::memory_order_release);
+		delete handle;
+		return nullptr;
+	}
+
+	return handle;
+}
+
+void ChessAI::GetLatestResult(SearchResult& result)
+{
+	MutexLocker locker(this->resultMutex);
+	result = this->latestResult;
+}
+
+void ChessAI::BeginSearch(ChessColor favoredColor, ChessGame* game)
+{
+	this->searchStopped = false;
+	this->nodeCount = 0;
+	this->nextClockPollNodeCount = 0;
+	this->nodeBudgetStartCount = 0;
+	this->searchStartTime = std::chrono::steady_clock::now();
+
+	if (favoredColor == ChessColor::White)
+		this->timeManager.Begin(this->searchLimits.whiteTimeSeconds, this->searchLimits.whiteIncrementSeconds, this->searchLimits.movesToGo);
+	else
+		this->timeManager.Begin(this->searchLimits.blackTimeSeconds, this->searchLimits.blackIncrementSeconds, this->searchLimits.movesToGo);
+
+	if (this->timeManager.IsActive())
+	{
+		ChessMoveArray legalMoveArray;
+		game->GenerateAllLegalMovesForColor(favoredColor, legalMoveArray);
+		if (legalMoveArray.size() == 1)
+			this->timeManager.SetSingleReply();
+		DeleteMoveArray(legalMoveArray);
+
+		const ChessMove* lastMove = game->GetMove(game->GetNumMoves() - 1);
+		if (dynamic_cast<const Capture*>(lastMove) || dynamic_cast<const EnPassant*>(lastMove))
+			this->timeManager.SetRecaptureLocation(lastMove->destinationLocation);
+	}
+
+	MutexLocker locker(this->resultMutex);
+	this->latestResult = SearchResult();
+}
+
+void ChessAI::EndSearch()
+{
+	this->timeManager.End();
+
+	MutexLocker locker(this->resultMutex);
+	this->latestResult.nodeCount = this->nodeCount;
+	this->latestResult.elapsedSeconds = this->GetElapsedSeconds();
+	this->latestResult.progress = 1.0f;
+	this->latestResult.complete = true;
+	if (this->searchLimits.deadlineSeconds > 0.0)
+		this->latestResult.slackSeconds = this->searchLimits.deadlineSeconds - this->latestResult.elapsedSeconds;
+}
+
+// This gets called a lot from the inner loops of the search, so it needs to stay cheap.
+bool ChessAI::ShouldStopSearch()
+{
+	if (!this->searchStopped)
+	{
+		// Only the search thread itself clears this, so it can't go away under us.
+		SearchHandle* handle = this->activeSearch.load(std::memory_order_relaxed);
+
+		if (handle && handle->stopFlag.load(std::memory_order_relaxed))
+			this->searchStopped = true;
+		else if (this->searchLimits.ponder)
+		{
+			// The clock isn't ours until the opponent actually plays the move we're pondering.
+			if (handle && handle->ponderHitFlag.load(std::memory_order_relaxed))
+			{
+				this->searchLimits.ponder = false;
+				this->searchStartTime = std::chrono::steady_clock::now();
+				this->nodeBudgetStartCount = this->nodeCount;
+			}
+		}
+		else if (this->searchLimits.maxNodes > 0 && this->nodeCount - this->nodeBudgetStartCount >= this->searchLimits.maxNodes)
+			this->searchStopped = true;
+		else if (this->nodeCount >= this->nextClockPollNodeCount)
+		{
+			this->nextClockPollNodeCount = this->nodeCount + this->clockPollInterval;
+
+			if (this->searchLimits.maxTimeSeconds > 0.0 || this->searchLimits.deadlineSeconds > 0.0 || this->timeManager.IsActive())
+			{
+				double elapsedSeconds = this->GetElapsedSeconds();
+				if (this->searchLimits.maxTimeSeconds > 0.0 && elapsedSeconds >= this->searchLimits.maxTimeSeconds)
+					this->searchStopped = true;
+				else if (this->searchLimits.deadlineSeconds > 0.0 && elapsedSeconds >= this->searchLimits.deadlineSeconds - this->searchLimits.deadlineReserveSeconds)
+					this->searchStopped = true;
+				else if (this->timeManager.HardLimitReached(elapsedSeconds))
+					this->searchStopped = true;
+			}
+		}
+	}
+
+	return this->searchStopped;
+}
+
+bool ChessAI::SoftTimeLimitReached() const
+{
+	if (this->searchLimits.ponder)
+		return false;
+
+	return this->timeManager.SoftLimitReached(this->GetElapsedSeconds());
+}
+
+void ChessAI::PublishResult(const SearchResult& result)
+{
+	MutexLocker locker(this->resultMutex);
+	this->latestResult = result;
+	this->latestResult.nodeCount = this->nodeCount;
+	this->latestResult.elapsedSeconds = this->GetElapsedSeconds();
+}
+
+double ChessAI::GetElapsedSeconds() const
+{
+	std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - this->searchStartTime;
+	return elapsedTime.count();
+}
+
+//---------------------------------------- ChessAI::SearchLimits ----------------------------------------
+
+ChessAI::SearchLimits::SearchLimits()
+{
+	this->maxTimeSeconds = 0.0;
+	this->ponder = false;
+	this->whiteTimeSeconds = 0.0;
+	this->blackTimeSeconds = 0.0;
+	this->whiteIncrementSeconds = 0.0;
+	this->blackIncrementSeconds = 0.0;
+	this->movesToGo = 0;
+	this->deadlineSeconds = 0.0;
+	this->deadlineReserveSeconds = 0.01;
+	this->maxNodes = 0;
+}
+
+//---------------------------------------- ChessAI::SearchResult ----------------------------------------
+
+ChessAI::SearchResult::SearchResult()
+{
+	this->bestMove = CHESS_PACKED_MOVE_NONE;
+	this->ponderMove = CHESS_PACKED_MOVE_NONE;
+	this->score = 0;
+	this->depth = 0;
+	this->nodeCount = 0;
+	this->elapsedSeconds = 0.0;
+	this->progress = 0.0f;
+	this->complete = false;
+	this->slackSeconds = 0.0;
+	this->failHighCount = 0;
+	this->failLowCount = 0;
+}
+
+//---------------------------------------- ChessAI::SearchHandle ----------------------------------------
+
+ChessAI::SearchHandle::SearchHandle(ChessAI* ai, ChessColor favoredColor, ChessGame* game, CompletionCallback completionCallback) : thread(this)
+{
+	this->ai = ai;
+	this->favoredColor = favoredColor;
+	this->game = game;
+	this->bestMove = nullptr;
+	this->ponderMove = CHESS_PACKED_MOVE_NONE;
+	this->stopFlag = false;
+	this->ponderHitFlag = false;
+	this->complete = false;
+	this->completionCallback = completionCallback;
+}
+
+/*virtual*/ ChessAI::SearchHandle::~SearchHandle()
+{
+	// Deleting ourselves from the completion callback would have the search thread wait on itself.
+	assert(completingHandle != this);
+
+	this->Stop();
+	this->Wait();
+
+	delete this->bestMove;
+	delete this->game;
+}
+
+void ChessAI::SearchHandle::Stop()
+{
+	this->stopFlag.store(true, std::memory_order_relaxed);
+}
+
+bool ChessAI::SearchHandle::IsComplete() const
+{
+	return this->complete.load(std::memory_order_acquire);
+}
+
+void ChessAI::SearchHandle::Wait()
+{
+	this->thread.WaitForThreadExit();
+}
+
+void ChessAI::SearchHandle::PonderHit()
+{
+	this->ponderHitFlag.store(true, std::memory_order_relaxed);
+}
+
+ChessPackedMove ChessAI::SearchHandle::GetPonderMove() const
+{
+	return this->ponderMove;
+}
+
+void ChessAI::SearchHandle::GetResult(SearchResult& result)
+{
+	if (this->IsComplete())
+		result = this->result;
+	else
+		this->ai->GetLatestResult(result);
+}
+
+ChessMove* ChessAI::SearchHandle::TakeBestMove()
+{
+	if (!this->IsComplete())
+		return nullptr;
+
+	ChessMove* move = this->bestMove;
+	this->bestMove = nullptr;
+	return move;
+}
+
+//---------------------------------------- ChessAI::SearchHandle::SearchThread ----------------------------------------
+
+ChessAI::SearchHandle::SearchThread::SearchThread(SearchHandle* handle)
+{
+	this->handle = handle;
+}
+
+/*virtual*/ ChessAI::SearchHandle::SearchThread::~SearchThread()
+{
+}
+
+/*virtual*/ int ChessAI::SearchHandle::SearchThread::ThreadFunc()
+{
+	ChessAI* ai = this->handle->ai;
+
+	this->handle->bestMove = ai->CalculateRecommendedMove(this->handle->favoredColor, this->handle->game);
+	ai->GetLatestResult(this->handle->result);
+
+	// Release the AI before anyone can see that we're done, so that a new search can be started right away.
+	ai->activeSearch.store(nullptr, std::memory_order_release);
+
+	this->handle->complete.store(true, std::memory_order_release);
+
+	if (this->handle->completionCallback)
+	{
+		completingHandle = this->handle;
+		this->handle->completionCallback(this->handle);
+		completingHandle = nullptr;
+	}
+
+	return 0;
+}
+
+/*virtual*/ void ChessAI::NewGame()
 {
 }
 
@@ -77,16 +407,85 @@ ChessAI::ChessAI()
 
 //---------------------------------------- ChessMinimaxAI ----------------------------------------
 
-ChessMinimaxAI::ChessMinimaxAI(int maxDepth)
+ChessMinimaxAI::ChessMinimaxAI(int maxDepth, int transpositionTableSize /*= 1 << 20*/)
 {
 	this->bestMoveArray = new ChessMoveArray();
+	this->bestReplyArray = new std::vector<ChessPackedMove>();
 	this->maxDepth = maxDepth;
+	this->evaluationNoise = 0;
+	this->searchDriver = SearchDriver::ASPIRATION;
+	this->aspirationDelta = 5;
+	this->aspirationGrowthFactor = 2;
+	this->aspirationFailHighCount = 0;
+	this->aspirationFailLowCount = 0;
+	this->searchDepth = 0;
+	this->previousPrincipalVariationLength = 0;
+	this->followPrincipalVariation = false;
+	this->clockPollInterval = 256;
+	this->transpositionTable = new ChessTranspositionTable(transpositionTableSize);
 	std::srand((unsigned int)time(nullptr));
+
+	this->NewGame();
 }
 
 /*virtual*/ ChessMinimaxAI::~ChessMinimaxAI()
 {
 	delete this->bestMoveArray;
+	delete this->bestReplyArray;
+	delete this->transpositionTable;
+}
+
+/*virtual*/ void ChessMinimaxAI::NewGame()
+{
+	this->transpositionTable->Clear();
+
+	for (int i = 0; i < CHESS_MAX_SEARCH_DEPTH; i++)
+		for (int j = 0; j < 2; j++)
+			this->killerMove[i][j] = CHESS_PACKED_MOVE_NONE;
+
+	for (int i = 0; i < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; i++)
+	{
+		for (int j = 0; j < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; j++)
+		{
+			this->historyTable[0][i][j] = 0;
+			this->historyTable[1][i][j] = 0;
+			this->counterMove[i][j] = CHESS_PACKED_MOVE_NONE;
+		}
+	}
+
+	this->lastRootNumMoves = 0;
+}
+
+// The new root is usually a couple of plies further into the game than the last one, so what we learned
+// last time is still mostly good.  We just trust it a little less.
+void ChessMinimaxAI::AgeSearchState(const ChessGame* game)
+{
+	this->transpositionTable->NewSearch();
+
+	for (int i = 0; i < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; i++)
+	{
+		for (int j = 0; j < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; j++)
+		{
+			this->historyTable[0][i][j] /= 2;
+			this->historyTable[1][i][j] /= 2;
+		}
+	}
+
+	// Killers are per ply, so they have to be shifted up by however many plies the root has moved down.
+	int numPlies = game->GetNumMoves() - this->lastRootNumMoves;
+	if (numPlies != 0)
+	{
+		for (int i = 0; i < CHESS_MAX_SEARCH_DEPTH; i++)
+		{
+			for (int j = 0; j < 2; j++)
+			{
+				int k = i + numPlies;
+				this->killerMove[i][j] = (numPlies > 0 && k < CHESS_MAX_SEARCH_DEPTH) ? this->killerMove[k][j] : CHESS_PACKED_MOVE_NONE;
+			}
+		}
+	}
+
+	this->lastRootNumMoves = game->GetNumMoves();
 }
 
 /*virtual*/ ChessMove* ChessMinimaxAI::CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game)
@@ -96,23 +495,142 @@ ChessMinimaxAI::ChessMinimaxAI(int maxDepth)
 	if(this->progressIndicator)
 		this->progressIndicator->ProgressBegin();
 
-	this->bestMoveArray->clear();
+	this->BeginSearch(favoredColor, game);
+	this->AgeSearchState(game);
+
+	this->aspirationFailHighCount = 0;
+	this->aspirationFailLowCount = 0;
 
 	int numMoves = game->GetNumMoves();
 
-	Score score{ 0, -1 };
-	bool success = this->Minimax(Goal::MAXIMIZE, favoredColor, favoredColor, game, 0, score);
+	// Each iteration generates its own moves, so we remember the outcome of the last one we can trust in packed form.
+	std::vector<ChessPackedMove> chosenMoveArray, chosenReplyArray;
+	int chosenScore = 0;
+	int chosenDepth = 0;
+	std::string chosenDescription;
+	std::vector<int> passesPerDepth;
+	int guessValue = this->EvaluationFunction(favoredColor, game);
 
-	assert(numMoves == game->GetNumMoves());
+	this->previousPrincipalVariationLength = 0;
 
-	if (success && this->bestMoveArray->size() > 0)
+	for (this->searchDepth = 1; this->searchDepth <= this->maxDepth && this->searchDepth < CHESS_MAX_SEARCH_DEPTH; this->searchDepth++)
 	{
-		int i = Random(0, this->bestMoveArray->size() - 1);
-		chosenMove = (*this->bestMoveArray)[i];
-		(*this->bestMoveArray)[i] = nullptr;
+		this->bestMoveArray->clear();
+		this->bestReplyArray->clear();
+		this->followPrincipalVariation = true;
+
+		Score score{ 0, -1 };
+		bool success = false;
+		if (this->searchDriver == SearchDriver::MINIMAX)
+			success = this->Minimax(Goal::MAXIMIZE, favoredColor, favoredColor, game, 0, score);
+		else
+		{
+			int numPasses = 0;
+			if (this->searchDriver == SearchDriver::MTDF)
+				success = this->MTDF(favoredColor, game, guessValue, numPasses);
+			else
+				success = this->AspirationSearch(favoredColor, game, guessValue, numPasses);
+			score.value = guessValue;
+			if (success)
+				passesPerDepth.push_back(numPasses);
+		}
+
+		assert(numMoves == game->GetNumMoves());
+
+		// If we were told to stop, we still go with the best of the root moves we managed to fully search.
+		// The previous iteration's best move is always searched first, so these are at least as well informed.
+		if ((success || this->searchStopped) && this->bestMoveArray->size() > 0)
+		{
+			chosenMoveArray.clear();
+			for (const ChessMove* move : *this->bestMoveArray)
+				chosenMoveArray.push_back(move->Pack());
+			chosenReplyArray = *this->bestReplyArray;
+			chosenDescription = (*this->bestMoveArray)[0]->GetDescription();
+			chosenScore = score.value;
+			chosenDepth = this->searchDepth;
+		}
+
 		DeleteMoveArray(*this->bestMoveArray);
+
+		if (!success)
+		{
+			// Being cancelled isn't the same as being told to stop.  In that case, we give no recommendation at all.
+			if (!this->searchStopped)
+				chosenMoveArray.clear();
+
+			break;
+		}
+
+		this->previousPrincipalVariationLength = this->principalVariationLength[0];
+		for (int i = 0; i < this->previousPrincipalVariationLength; i++)
+			this->previousPrincipalVariation[i] = this->principalVariation[0][i];
+
+		if (chosenMoveArray.size() > 0)
+		{
+			this->timeManager.OnIterationComplete(chosenMoveArray[0]);
+
+			SearchResult result;
+			this->GetLatestResult(result);
+			result.bestMove = chosenMoveArray[0];
+			result.ponderMove = chosenReplyArray[0];
+			result.bestMoveDescription = chosenDescription;
+			result.score = chosenScore;
+			result.depth = chosenDepth;
+			result.progress = float(this->searchDepth) / float(this->maxDepth);
+			result.passesPerDepth = passesPerDepth;
+			result.failHighCount = this->aspirationFailHighCount;
+			result.failLowCount = this->aspirationFailLowCount;
+			this->PublishResult(result);
+		}
+
+		// There's no point in looking deeper once we've found the game's outcome.
+		if (IsMateValue(chosenScore))
+			break;
+
+		if (this->SoftTimeLimitReached())
+			break;
+	}
+
+	// If we ran out of time before even one ply was searched, we still owe a move.  Move ordering is all we've got.
+	if (chosenMoveArray.size() == 0 && this->searchStopped)
+	{
+		ChessMoveArray legalMoveArray;
+		game->GenerateAllLegalMovesForColor(favoredColor, legalMoveArray);
+		const ChessMove* bestGuessMove = nullptr;
+		for (const ChessMove* move : legalMoveArray)
+		{
+			if (!bestGuessMove || move->GetSortKey() > bestGuessMove->GetSortKey())
+				bestGuessMove = move;
+		}
+		if (bestGuessMove)
+		{
+			chosenMoveArray.push_back(bestGuessMove->Pack());
+			chosenReplyArray.push_back(CHESS_PACKED_MOVE_NONE);
+		}
+		DeleteMoveArray(legalMoveArray);
+	}
+
+	if (chosenMoveArray.size() > 0)
+	{
+		int i = Random(0, chosenMoveArray.size() - 1);
+		chosenMove = game->UnpackMove(favoredColor, chosenMoveArray[i]);
+		if (chosenMove)
+		{
+			SearchResult result;
+			result.bestMove = chosenMoveArray[i];
+			result.ponderMove = chosenReplyArray[i];
+			result.bestMoveDescription = chosenMove->GetDescription();
+			result.score = chosenScore;
+			result.depth = chosenDepth;
+			result.passesPerDepth = passesPerDepth;
+			result.failHighCount = this->aspirationFailHighCount;
+			result.failLowCount = this->aspirationFailLowCount;
+			this->PublishResult(result);
+		}
 	}
 
+	this->EndSearch();
+
 	if (this->progressIndicator)
 		this->progressIndicator->ProgressEnd();
 
@@ -121,13 +639,79 @@ ChessMinimaxAI::ChessMinimaxAI(int maxDepth)
 
 bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whoseTurn, ChessGame* game, int depth, Score& score, Score* currentSuperScore /*= nullptr*/)
 {
-	if (depth >= this->maxDepth)
+	this->nodeCount++;
+	this->principalVariationLength[depth] = depth;
+
+	if (this->ShouldStopSearch())
+		return false;
+
+	// We only stay on the previous iteration's principal variation if our parent was on it too.
+	bool onPrincipalVariation = this->followPrincipalVariation;
+	this->followPrincipalVariation = false;
+
+	if (depth >= this->searchDepth || depth >= CHESS_MAX_SEARCH_DEPTH - 1)
 	{
 		score.value = this->EvaluationFunction(favoredColor, game);
+		if (this->evaluationNoise > 0)
+			score.value += Random(-this->evaluationNoise, this->evaluationNoise);
 		score.depth = depth;
 		return true;
 	}
 
+	// Scores are from the favored color's point of view, so each color gets its own entries.
+	uint64_t hashKey = game->GetHashKey(whoseTurn);
+	if (favoredColor == ChessColor::Black)
+		hashKey = ~hashKey;
+
+	int remainingDepth = this->searchDepth - depth;
+	ChessPackedMove hashMove = CHESS_PACKED_MOVE_NONE;
+	const ChessTranspositionTable::Entry* entry = this->transpositionTable->Probe(hashKey);
+	if (entry)
+	{
+		hashMove = entry->move;
+
+		// We can't do this at the root, because we need to know what all the best moves are there.
+		if (depth > 0 && entry->draft >= remainingDepth)
+		{
+			bool useEntry = false;
+			switch (entry->bound)
+			{
+				case ChessTranspositionTable::Bound::EXACT:
+				{
+					useEntry = true;
+					break;
+				}
+				case ChessTranspositionTable::Bound::LOWER:
+				{
+					useEntry = (goal == Goal::MAXIMIZE && entry->value > currentSuperScore->value);
+					break;
+				}
+				case ChessTranspositionTable::Bound::UPPER:
+				{
+					useEntry = (goal == Goal::MINIMIZE && entry->value < currentSuperScore->value);
+					break;
+				}
+				default:
+				{
+					// Probe() never gives back an empty entry.
+					break;
+				}
+			}
+
+			if (useEntry)
+			{
+				score.value = entry->value;
+				score.depth = depth + entry->distance;
+				if (hashMove != CHESS_PACKED_MOVE_NONE)
+				{
+					this->principalVariationLength[depth + 1] = depth + 1;
+					this->UpdatePrincipalVariation(depth, hashMove);
+				}
+				return true;
+			}
+		}
+	}
+
 	ChessMoveArray legalMoveArray;
 	GameResult result = game->GenerateAllLegalMovesForColor(whoseTurn, legalMoveArray);
 	switch (result)
@@ -147,9 +731,22 @@ bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whos
 	}
 
 	// We sort the legal moves in order of possibly best to worst.  This may improve the alpha-beta pruning.
-	std::sort(legalMoveArray.begin(), legalMoveArray.end(), [&legalMoveArray](const ChessMove* moveA, const ChessMove* moveB) -> bool {
-		return moveA->GetSortKey() > moveB->GetSortKey();
-	});
+	this->OrderMoves(legalMoveArray, whoseTurn, game, depth, hashMove);
+
+	// Better still is to try the move the last iteration thought best.
+	bool principalVariationMoveFirst = false;
+	if (onPrincipalVariation && depth < this->previousPrincipalVariationLength)
+	{
+		for (int i = 0; i < (signed)legalMoveArray.size(); i++)
+		{
+			if (legalMoveArray[i]->Pack() == this->previousPrincipalVariation[depth])
+			{
+				std::rotate(legalMoveArray.begin(), legalMoveArray.begin() + i, legalMoveArray.begin() + i + 1);
+				principalVariationMoveFirst = true;
+				break;
+			}
+		}
+	}
 
 	score.value = 0;
 	score.depth = depth;
@@ -172,6 +769,8 @@ bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whos
 	}
 
 	bool success = true;
+	bool pruned = false;
+	ChessPackedMove bestPackedMove = CHESS_PACKED_MOVE_NONE;
 
 	for (int i = 0; i < (signed)legalMoveArray.size(); i++)
 	{
@@ -183,6 +782,7 @@ bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whos
 		Goal opponentGoal = (goal == Goal::MAXIMIZE) ? Goal::MINIMIZE : Goal::MAXIMIZE;
 
 		Score subScore{ 0, -1 };
+		this->followPrincipalVariation = (principalVariationMoveFirst && i == 0);
 		success = this->Minimax(opponentGoal, favoredColor, otherColor, game, depth + 1, subScore, &score);
 
 		game->PopMove();
@@ -196,26 +796,48 @@ bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whos
 		{
 			score = subScore;
 
+			bestPackedMove = legalMove->Pack();
+			this->UpdatePrincipalVariation(depth, bestPackedMove);
+
 			if (depth == 0)
 			{
 				this->bestMoveArray->clear();
 				this->bestMoveArray->push_back(legalMove);
+				this->bestReplyArray->clear();
+				this->bestReplyArray->push_back((this->principalVariationLength[1] > 1) ? this->principalVariation[1][1] : CHESS_PACKED_MOVE_NONE);
 			}
 			else if ((goal == Goal::MINIMIZE && score.value < currentSuperScore->value) || (goal == Goal::MAXIMIZE && score.value > currentSuperScore->value))
 			{
 				// This is the so-called "alpha-beta" prune case.
+				pruned = true;
+				this->RecordCutoff(legalMove, whoseTurn, game, depth, remainingDepth);
 				break;
 			}
 		}
 		else if (depth == 0 && score.value == subScore.value && score.depth == subScore.depth)
 		{
 			this->bestMoveArray->push_back(legalMove);
+			this->bestReplyArray->push_back((this->principalVariationLength[1] > 1) ? this->principalVariation[1][1] : CHESS_PACKED_MOVE_NONE);
 		}
 
-		if (depth == 0 && this->progressIndicator)
+		if (depth == 0)
 		{
-			float percentage = float(i + 1) / float(legalMoveArray.size());
-			if (!this->progressIndicator->ProgressUpdate(percentage))
+			float percentage = (float(this->searchDepth - 1) + float(i + 1) / float(legalMoveArray.size())) / float(this->maxDepth);
+
+			if (this->bestMoveArray->size() > 0)
+			{
+				const ChessMove* bestMove = (*this->bestMoveArray)[0];
+				SearchResult result;
+				result.bestMove = bestMove->Pack();
+				result.ponderMove = (*this->bestReplyArray)[0];
+				result.bestMoveDescription = bestMove->GetDescription();
+				result.score = score.value;
+				result.depth = this->searchDepth;
+				result.progress = percentage;
+				this->PublishResult(result);
+			}
+
+			if (this->progressIndicator && !this->progressIndicator->ProgressUpdate(percentage))
 			{
 				success = false;
 				break;
@@ -225,7 +847,8 @@ bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whos
 
 	if (depth == 0)
 	{
-		if (!success)
+		// Being told to stop isn't the same as being cancelled.  In that case, hang on to what we've got so far.
+		if (!success && !this->searchStopped)
 			this->bestMoveArray->clear();
 		else
 		{
@@ -245,167 +868,1048 @@ bool ChessMinimaxAI::Minimax(Goal goal, ChessColor favoredColor, ChessColor whos
 
 	DeleteMoveArray(legalMoveArray);
 
-	return success;
-}
+	// A prune means we stopped looking once we knew our parent wouldn't want us, so then all we have is a bound.
+	if (success)
+	{
+		ChessTranspositionTable::Bound bound = ChessTranspositionTable::Bound::EXACT;
+		if (pruned)
+			bound = (goal == Goal::MAXIMIZE) ? ChessTranspositionTable::Bound::LOWER : ChessTranspositionTable::Bound::UPPER;
 
-//---------------------------------------- ChessMontoCarloTreeSearchAI ----------------------------------------
+		this->transpositionTable->Store(hashKey, score.value, score.depth - depth, remainingDepth, bound, bestPackedMove);
+	}
 
-ChessMonteCarloTreeSearchAI::ChessMonteCarloTreeSearchAI(double maxTimeSeconds, int maxIterations)
-{
-	this->maxTimeSeconds = maxTimeSeconds;
-	this->maxIterations = maxIterations;
-	this->numGamesPerRollout = 32;
-	this->numRolloutThreads = 8;
-	this->rolloutThreadArray = new RolloutThreadArray();
+	return success;
 }
 
-/*virtual*/ ChessMonteCarloTreeSearchAI::~ChessMonteCarloTreeSearchAI()
+// MTD(f) homes in on the minimax value with a series of null-window searches, each of which only tells us
+// whether the value is above or below some guess.  Each pass is cheap, because it prunes so much, and it leans
+// on the transposition table to not redo the work of the passes before it.  The better the guess, the fewer
+// passes, which is why we guess with the value from the previous depth.
+// See: https://www.chessprogramming.org/MTD(f)
+bool ChessMinimaxAI::MTDF(ChessColor favoredColor, ChessGame* game, int& value, int& numPasses)
 {
-	delete this->rolloutThreadArray;
-}
+	int lowerBound = INT_MIN;
+	int upperBound = INT_MAX;
+	ChessPackedMove bestMove = CHESS_PACKED_MOVE_NONE;
 
-/*virtual*/ ChessMove* ChessMonteCarloTreeSearchAI::CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game)
-{
-	if (this->progressIndicator)
-		this->progressIndicator->ProgressBegin();
+	numPasses = 0;
 
-	// Spin up a thread pool we can use to accelerate the processing of roll-outs.
-	for (int i = 0; i < this->numRolloutThreads; i++)
+	while (lowerBound < upperBound)
 	{
-		RolloutThread* thread = new RolloutThread();
-		thread->SpawnThread();
-		this->rolloutThreadArray->push_back(thread);
-	}
+		int beta = (value == lowerBound) ? value + 1 : value;
 
-	Node* root = new Node(nullptr, nullptr);
+		ChessPackedMove passBestMove = CHESS_PACKED_MOVE_NONE;
+		if (!this->AlphaBetaSearch(Goal::MAXIMIZE, favoredColor, favoredColor, game, 0, beta - 1, beta, value, &passBestMove))
+			return false;
 
-	clock_t startTimeTicks = ::clock();
-	int iterationCount = 0;
+		numPasses++;
 
-	while (true)
-	{
-		if (this->maxIterations > 0)
+		// Only a pass that fails high proves that its best move is as good as the value.
+		if (value < beta)
+			upperBound = value;
+		else
 		{
-			iterationCount++;
-			if (this->progressIndicator)
-				this->progressIndicator->ProgressUpdate(float(iterationCount) / float(this->maxIterations));
-			if (iterationCount >= this->maxIterations)
+			lowerBound = value;
+			bestMove = passBestMove;
+		}
+	}
+
+	this->SetRootBestMove(favoredColor, game, bestMove);
+	return true;
+}
+
+// Rather than search the root with a wide open window, we bet that the value won't stray far from what it was
+// at the previous depth.  The narrower window prunes more.  If we lose the bet, we search again with the window
+// widened on the side we fell out of, and widen it faster each time we have to do that.
+// See: https://www.chessprogramming.org/Aspiration_Windows
+bool ChessMinimaxAI::AspirationSearch(ChessColor favoredColor, ChessGame* game, int& value, int& numPasses)
+{
+	int64_t delta = this->aspirationDelta;
+	int alpha = INT_MIN;
+	int beta = INT_MAX;
+	if (this->searchDepth > 1 && delta > 0 && !IsMateValue(value))
+	{
+		alpha = int(std::max(int64_t(INT_MIN), int64_t(value) - delta));
+		beta = int(std::min(int64_t(INT_MAX), int64_t(value) + delta));
+	}
+
+	ChessPackedMove bestMove = CHESS_PACKED_MOVE_NONE;
+
+	numPasses = 0;
+
+	while (true)
+	{
+		int passValue = 0;
+		if (!this->AlphaBetaSearch(Goal::MAXIMIZE, favoredColor, favoredColor, game, 0, alpha, beta, passValue, &bestMove))
+			return false;
+
+		numPasses++;
+
+		delta *= (this->aspirationGrowthFactor > 1) ? this->aspirationGrowthFactor : 2;
+
+		// Once we're into mate scores, there's no sense in being stingy about the window.
+		if (passValue <= alpha)
+		{
+			this->aspirationFailLowCount++;
+			alpha = IsMateValue(passValue) ? INT_MIN : int(std::max(int64_t(INT_MIN), int64_t(passValue) - delta));
+		}
+		else if (passValue >= beta)
+		{
+			this->aspirationFailHighCount++;
+			beta = IsMateValue(passValue) ? INT_MAX : int(std::min(int64_t(INT_MAX), int64_t(passValue) + delta));
+		}
+		else
+		{
+			value = passValue;
+			break;
+		}
+	}
+
+	this->SetRootBestMove(favoredColor, game, bestMove);
+	return true;
+}
+
+void ChessMinimaxAI::SetRootBestMove(ChessColor favoredColor, ChessGame* game, ChessPackedMove bestMove)
+{
+	this->principalVariationLength[0] = 0;
+
+	ChessMove* move = game->UnpackMove(favoredColor, bestMove);
+	if (move)
+	{
+		// We don't keep a principal variation in the window searches, but the table likely knows how the opponent would reply.
+		ChessPackedMove reply = CHESS_PACKED_MOVE_NONE;
+		game->PushMove(move);
+		ChessColor opponentColor = (favoredColor == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+		uint64_t hashKey = game->GetHashKey(opponentColor);
+		if (favoredColor == ChessColor::Black)
+			hashKey = ~hashKey;
+		const ChessTranspositionTable::Entry* entry = this->transpositionTable->Probe(hashKey);
+		if (entry)
+			reply = entry->move;
+		game->PopMove();
+
+		this->bestMoveArray->push_back(move);
+		this->bestReplyArray->push_back(reply);
+
+		this->principalVariation[0][0] = bestMove;
+		this->principalVariationLength[0] = 1;
+	}
+}
+
+// Unlike the minimax search above, the window searches fold how far away a mate is into its value, so that they
+// go for the quickest one.  The table holds them the minimax search's way, as a flat value and a distance.
+/*static*/ bool ChessMinimaxAI::IsMateValue(int value)
+{
+	return value >= 10000 - CHESS_MAX_SEARCH_DEPTH || value <= -10000 + CHESS_MAX_SEARCH_DEPTH;
+}
+
+// This is just alpha-beta, written in minimax form to match the rest of this class.  It fails soft, so
+// that the value we return is as tight a bound as we can give when it falls outside the window.
+bool ChessMinimaxAI::AlphaBetaSearch(Goal goal, ChessColor favoredColor, ChessColor whoseTurn, ChessGame* game, int depth, int alpha, int beta, int& value, ChessPackedMove* bestMove /*= nullptr*/)
+{
+	this->nodeCount++;
+
+	if (this->ShouldStopSearch())
+		return false;
+
+	if (depth >= this->searchDepth || depth >= CHESS_MAX_SEARCH_DEPTH - 1)
+	{
+		value = this->EvaluationFunction(favoredColor, game);
+		if (this->evaluationNoise > 0)
+			value += Random(-this->evaluationNoise, this->evaluationNoise);
+		return true;
+	}
+
+	uint64_t hashKey = game->GetHashKey(whoseTurn);
+	if (favoredColor == ChessColor::Black)
+		hashKey = ~hashKey;
+
+	int remainingDepth = this->searchDepth - depth;
+	ChessPackedMove hashMove = CHESS_PACKED_MOVE_NONE;
+	const ChessTranspositionTable::Entry* entry = this->transpositionTable->Probe(hashKey);
+	if (entry)
+	{
+		hashMove = entry->move;
+
+		if (depth > 0 && entry->draft >= remainingDepth)
+		{
+			int entryValue = entry->value;
+			if (entryValue >= 10000)
+				entryValue = 10000 - (depth + entry->distance);
+			else if (entryValue <= -10000)
+				entryValue = -10000 + (depth + entry->distance);
+
+			if (entry->bound == ChessTranspositionTable::Bound::EXACT ||
+				(entry->bound == ChessTranspositionTable::Bound::LOWER && entryValue >= beta) ||
+				(entry->bound == ChessTranspositionTable::Bound::UPPER && entryValue <= alpha))
+			{
+				value = entryValue;
+				return true;
+			}
+		}
+	}
+
+	ChessMoveArray legalMoveArray;
+	GameResult result = game->GenerateAllLegalMovesForColor(whoseTurn, legalMoveArray);
+	switch (result)
+	{
+		case GameResult::CheckMate:
+		{
+			value = (whoseTurn == favoredColor) ? -(10000 - depth) : (10000 - depth);
+			return true;
+		}
+		case GameResult::StaleMate:
+		{
+			value = -(10000 - depth);
+			return true;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	this->OrderMoves(legalMoveArray, whoseTurn, game, depth, hashMove);
+
+	value = (goal == Goal::MAXIMIZE) ? INT_MIN : INT_MAX;
+	ChessPackedMove bestPackedMove = CHESS_PACKED_MOVE_NONE;
+	bool success = true;
+	int originalAlpha = alpha;
+	int originalBeta = beta;
+
+	ChessColor otherColor = (whoseTurn == ChessColor::Black) ? ChessColor::White : ChessColor::Black;
+	Goal opponentGoal = (goal == Goal::MAXIMIZE) ? Goal::MINIMIZE : Goal::MAXIMIZE;
+
+	for (int i = 0; i < (signed)legalMoveArray.size(); i++)
+	{
+		ChessMove* legalMove = legalMoveArray[i];
+
+		game->PushMove(legalMove);
+
+		int subValue = 0;
+		success = this->AlphaBetaSearch(opponentGoal, favoredColor, otherColor, game, depth + 1, alpha, beta, subValue);
+
+		game->PopMove();
+
+		if (!success)
+			break;
+
+		if ((goal == Goal::MAXIMIZE && subValue > value) || (goal == Goal::MINIMIZE && subValue < value))
+		{
+			value = subValue;
+			bestPackedMove = legalMove->Pack();
+		}
+
+		if (goal == Goal::MAXIMIZE)
+		{
+			if (value >= beta)
+			{
+				this->RecordCutoff(legalMove, whoseTurn, game, depth, remainingDepth);
 				break;
+			}
+			if (value > alpha)
+				alpha = value;
 		}
-		else if (this->maxTimeSeconds > 0.0)
+		else
 		{
-			clock_t currentTimeTicks = ::clock();
-			clock_t elapsedTimeTicks = currentTimeTicks - startTimeTicks;
-			double elapsedTimeSeconds = double(elapsedTimeTicks) / double(CLOCKS_PER_SEC);
-			if (elapsedTimeSeconds > this->maxTimeSeconds)
+			if (value <= alpha)
+			{
+				this->RecordCutoff(legalMove, whoseTurn, game, depth, remainingDepth);
 				break;
-			if (this->progressIndicator)
-				this->progressIndicator->ProgressUpdate(float(elapsedTimeSeconds) / float(this->maxTimeSeconds));
+			}
+			if (value < beta)
+				beta = value;
+		}
+
+		if (depth == 0)
+		{
+			float percentage = (float(this->searchDepth - 1) + float(i + 1) / float(legalMoveArray.size())) / float(this->maxDepth);
+			if (this->progressIndicator && !this->progressIndicator->ProgressUpdate(percentage))
+			{
+				success = false;
+				break;
+			}
+		}
+	}
+
+	DeleteMoveArray(legalMoveArray);
+
+	if (success)
+	{
+		ChessTranspositionTable::Bound bound = ChessTranspositionTable::Bound::EXACT;
+		if (value >= originalBeta)
+			bound = ChessTranspositionTable::Bound::LOWER;
+		else if (value <= originalAlpha)
+			bound = ChessTranspositionTable::Bound::UPPER;
+
+		int storedValue = value;
+		int distance = 0;
+		if (IsMateValue(value))
+		{
+			storedValue = (value > 0) ? 10000 : -10000;
+			distance = (10000 - ((value > 0) ? value : -value)) - depth;
+		}
+
+		this->transpositionTable->Store(hashKey, storedValue, distance, remainingDepth, bound, bestPackedMove);
+
+		if (bestMove)
+			*bestMove = bestPackedMove;
+	}
+
+	return success;
+}
+
+void ChessMinimaxAI::OrderMoves(ChessMoveArray& moveArray, ChessColor whoseTurn, const ChessGame* game, int depth, ChessPackedMove hashMove)
+{
+	ChessPackedMove counterMove = CHESS_PACKED_MOVE_NONE;
+	const ChessMove* lastMove = game->GetMove(game->GetNumMoves() - 1);
+	if (lastMove)
+	{
+		ChessPackedMove lastPackedMove = lastMove->Pack();
+		counterMove = this->counterMove[lastPackedMove & 0x3F][(lastPackedMove >> 6) & 0x3F];
+	}
+
+	// Whatever the table says was best goes first, then captures and promotions, then the quiet moves that
+	// have pruned before, and then the rest of the quiet moves in order of how often they've pruned.
+	std::vector<std::pair<int, ChessMove*>> keyedMoveArray;
+	keyedMoveArray.reserve(moveArray.size());
+	for (ChessMove* move : moveArray)
+	{
+		ChessPackedMove packedMove = move->Pack();
+		int key = 0;
+		if (packedMove == hashMove)
+			key = INT_MAX;
+		else if (move->GetSortKey() >= 2)
+			key = 1000000 * move->GetSortKey();
+		else if (packedMove == this->killerMove[depth][0])
+			key = 900000;
+		else if (packedMove == this->killerMove[depth][1])
+			key = 800000;
+		else if (packedMove == counterMove)
+			key = 700000;
+		else
+			key = this->historyTable[int(whoseTurn)][packedMove & 0x3F][(packedMove >> 6) & 0x3F];
+		keyedMoveArray.push_back(std::pair<int, ChessMove*>(key, move));
+	}
+
+	std::stable_sort(keyedMoveArray.begin(), keyedMoveArray.end(), [](const std::pair<int, ChessMove*>& pairA, const std::pair<int, ChessMove*>& pairB) -> bool {
+		return pairA.first > pairB.first;
+	});
+
+	for (int i = 0; i < (signed)moveArray.size(); i++)
+		moveArray[i] = keyedMoveArray[i].second;
+}
+
+void ChessMinimaxAI::RecordCutoff(const ChessMove* move, ChessColor whoseTurn, const ChessGame* game, int depth, int remainingDepth)
+{
+	// Captures and promotions get tried early anyway.  It's the quiet moves we need help with.
+	if (move->GetSortKey() >= 2)
+		return;
+
+	ChessPackedMove packedMove = move->Pack();
+	if (this->killerMove[depth][0] != packedMove)
+	{
+		this->killerMove[depth][1] = this->killerMove[depth][0];
+		this->killerMove[depth][0] = packedMove;
+	}
+
+	// Keep history scores well under the killer keys.  Halving them all keeps their order.
+	int& history = this->historyTable[int(whoseTurn)][packedMove & 0x3F][(packedMove >> 6) & 0x3F];
+	history += remainingDepth * remainingDepth;
+	if (history > 500000)
+	{
+		for (int i = 0; i < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; i++)
+			for (int j = 0; j < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; j++)
+				this->historyTable[int(whoseTurn)][i][j] /= 2;
+	}
+
+	const ChessMove* lastMove = game->GetMove(game->GetNumMoves() - 1);
+	if (lastMove)
+	{
+		ChessPackedMove lastPackedMove = lastMove->Pack();
+		this->counterMove[lastPackedMove & 0x3F][(lastPackedMove >> 6) & 0x3F] = packedMove;
+	}
+}
+
+void ChessMinimaxAI::UpdatePrincipalVariation(int depth, ChessPackedMove move)
+{
+	// The line below us was just left in the next row down by the recursive call that produced it.
+	this->principalVariation[depth][depth] = move;
+	int length = this->principalVariationLength[depth + 1];
+	for (int i = depth + 1; i < length; i++)
+		this->principalVariation[depth][i] = this->principalVariation[depth + 1][i];
+	this->principalVariationLength[depth] = (length > depth + 1) ? length : depth + 1;
+}
+
+//---------------------------------------- ChessProofNumberAI ----------------------------------------
+
+#define CHESS_PROOF_NUMBER_INFINITY		100000000
+
+ChessProofNumberAI::ChessProofNumberAI(int maxMateMoves, int tableSize /*= 1 << 20*/)
+{
+	this->maxMateMoves = maxMateMoves;
+	this->proof = Proof::UNKNOWN;
+	this->matingLine = new std::vector<ChessPackedMove>();
+	this->clockPollInterval = 256;
+
+	this->numEntries = 1;
+	while (this->numEntries * 2 <= tableSize)
+		this->numEntries *= 2;
+
+	this->entryArray = new Entry[this->numEntries];
+	this->NewGame();
+}
+
+/*virtual*/ ChessProofNumberAI::~ChessProofNumberAI()
+{
+	delete this->matingLine;
+	delete[] this->entryArray;
+}
+
+/*virtual*/ void ChessProofNumberAI::NewGame()
+{
+	this->generation = 0;
+
+	for (int i = 0; i < this->numEntries; i++)
+	{
+		Entry* entry = &this->entryArray[i];
+		entry->key = 0;
+		entry->proofNumber = 1;
+		entry->disproofNumber = 1;
+		entry->generation = 0;
+	}
+}
+
+int ChessProofNumberAI::GetMaxPlies() const
+{
+	// Mate in N is N of our moves and N - 1 of theirs.
+	int maxPlies = 2 * this->maxMateMoves - 1;
+	if (maxPlies <= 0 || maxPlies > CHESS_MAX_SEARCH_DEPTH - 1)
+		maxPlies = CHESS_MAX_SEARCH_DEPTH - 1;
+
+	return maxPlies;
+}
+
+/*virtual*/ ChessMove* ChessProofNumberAI::CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game)
+{
+	ChessMove* chosenMove = nullptr;
+
+	if (this->progressIndicator)
+		this->progressIndicator->ProgressBegin();
+
+	this->BeginSearch(favoredColor, game);
+
+	// Entries from earlier searches are still good, but they're the first to go when we need the room.
+	this->generation++;
+	this->proof = Proof::UNKNOWN;
+	this->matingLine->clear();
+
+	int numMoves = game->GetNumMoves();
+
+	uint64_t rootKey = game->GetHashKey(favoredColor);
+	uint32_t proofNumber = 1, disproofNumber = 1;
+	if (this->MultipleIterativeDeepening(favoredColor, favoredColor, game, 0, rootKey, CHESS_PROOF_NUMBER_INFINITY, CHESS_PROOF_NUMBER_INFINITY, proofNumber, disproofNumber))
+	{
+		if (proofNumber == 0)
+			this->proof = Proof::PROVEN;
+		else if (disproofNumber == 0)
+			this->proof = Proof::DISPROVEN;
+	}
+
+	assert(numMoves == game->GetNumMoves());
+
+	if (this->proof == Proof::PROVEN)
+	{
+		this->ExtractMatingLine(favoredColor, game);
+
+		if (this->matingLine->size() > 0)
+		{
+			chosenMove = game->UnpackMove(favoredColor, (*this->matingLine)[0]);
+
+			SearchResult result;
+			result.bestMove = (*this->matingLine)[0];
+			result.ponderMove = (this->matingLine->size() > 1) ? (*this->matingLine)[1] : CHESS_PACKED_MOVE_NONE;
+			result.bestMoveDescription = chosenMove ? chosenMove->GetDescription() : "";
+			result.score = 10000 - int(this->matingLine->size());
+			result.depth = int(this->matingLine->size());
+			this->PublishResult(result);
+		}
+	}
+
+	this->EndSearch();
+
+	if (this->progressIndicator)
+		this->progressIndicator->ProgressEnd();
+
+	return chosenMove;
+}
+
+// The attacker is at the OR nodes, where one proven move is proof enough.  The defender is at the AND nodes,
+// where every move has to be proven.  A proof number is how many more positions we'd need to prove to prove
+// this one.  A disproof number is the same, but for disproving it.  At each node, we keep going down the most
+// promising child until its numbers reach the thresholds given by our parent, at which point some other part of
+// the tree looks more promising, and we go back up.
+bool ChessProofNumberAI::MultipleIterativeDeepening(ChessColor attackingColor, ChessColor whoseTurn, ChessGame* game, int depth, uint64_t positionKey, uint32_t proofThreshold, uint32_t disproofThreshold, uint32_t& proofNumber, uint32_t& disproofNumber)
+{
+	this->nodeCount++;
+
+	if (this->ShouldStopSearch())
+		return false;
+
+	bool attacking = (whoseTurn == attackingColor);
+
+	ChessMoveArray legalMoveArray;
+	GameResult result = game->GenerateAllLegalMovesForColor(whoseTurn, legalMoveArray);
+	if (legalMoveArray.size() == 0)
+	{
+		proofNumber = (result == GameResult::CheckMate && !attacking) ? 0 : CHESS_PROOF_NUMBER_INFINITY;
+		disproofNumber = (proofNumber == 0) ? CHESS_PROOF_NUMBER_INFINITY : 0;
+		this->Store(positionKey, depth, proofNumber, disproofNumber);
+		return true;
+	}
+
+	// If it isn't mate by now, then it isn't mate in the number of moves we were given.
+	if (depth >= this->GetMaxPlies())
+	{
+		proofNumber = CHESS_PROOF_NUMBER_INFINITY;
+		disproofNumber = 0;
+		this->Store(positionKey, depth, proofNumber, disproofNumber);
+		DeleteMoveArray(legalMoveArray);
+		return true;
+	}
+
+	this->pathKeyArray[depth] = positionKey;
+
+	ChessColor otherColor = (whoseTurn == ChessColor::Black) ? ChessColor::White : ChessColor::Black;
+
+	std::vector<uint64_t> childKeyArray;
+	std::vector<bool> childRepeatsArray;
+	for (ChessMove* move : legalMoveArray)
+	{
+		game->PushMove(move);
+		uint64_t childKey = game->GetHashKey(otherColor);
+		game->PopMove();
+
+		bool repeats = false;
+		for (int i = 0; i <= depth && !repeats; i++)
+			repeats = (this->pathKeyArray[i] == childKey);
+
+		childKeyArray.push_back(childKey);
+		childRepeatsArray.push_back(repeats);
+	}
+
+	// What the children gave back when we last went down them.  We fall back on these when the table has lost a
+	// child to some other position, since otherwise we'd be starting that child over from scratch, and two children
+	// sharing a slot could keep knocking each other out of the table, with us going back and forth between them forever.
+	std::vector<uint32_t> childProofArray(legalMoveArray.size(), 1);
+	std::vector<uint32_t> childDisproofArray(legalMoveArray.size(), 1);
+
+	bool success = true;
+
+	while (true)
+	{
+		proofNumber = attacking ? CHESS_PROOF_NUMBER_INFINITY : 0;
+		disproofNumber = attacking ? 0 : CHESS_PROOF_NUMBER_INFINITY;
+		int bestChild = -1;
+		uint32_t bestChildProofNumber = 0, bestChildDisproofNumber = 0;
+		uint32_t secondBestNumber = CHESS_PROOF_NUMBER_INFINITY;
+
+		for (int i = 0; i < (signed)legalMoveArray.size(); i++)
+		{
+			uint32_t childProofNumber = CHESS_PROOF_NUMBER_INFINITY, childDisproofNumber = 0;
+			if (!childRepeatsArray[i] && !this->LookUp(childKeyArray[i], depth + 1, childProofNumber, childDisproofNumber))
+			{
+				childProofNumber = childProofArray[i];
+				childDisproofNumber = childDisproofArray[i];
+			}
+
+			// The attacker wants the child that's easiest to prove; the defender, the one that's easiest to disprove.
+			uint32_t childNumber = attacking ? childProofNumber : childDisproofNumber;
+			uint32_t bestNumber = attacking ? bestChildProofNumber : bestChildDisproofNumber;
+			if (bestChild < 0 || childNumber < bestNumber)
+			{
+				if (bestChild >= 0)
+					secondBestNumber = bestNumber;
+				bestChild = i;
+				bestChildProofNumber = childProofNumber;
+				bestChildDisproofNumber = childDisproofNumber;
+			}
+			else if (childNumber < secondBestNumber)
+				secondBestNumber = childNumber;
+
+			if (attacking)
+			{
+				proofNumber = std::min(proofNumber, childProofNumber);
+				disproofNumber = std::min(disproofNumber + childDisproofNumber, uint32_t(CHESS_PROOF_NUMBER_INFINITY));
+			}
+			else
+			{
+				proofNumber = std::min(proofNumber + childProofNumber, uint32_t(CHESS_PROOF_NUMBER_INFINITY));
+				disproofNumber = std::min(disproofNumber, childDisproofNumber);
+			}
+		}
+
+		this->Store(positionKey, depth, proofNumber, disproofNumber);
+
+		if (proofNumber >= proofThreshold || disproofNumber >= disproofThreshold)
+			break;
+
+		uint32_t childProofThreshold, childDisproofThreshold;
+		if (attacking)
+		{
+			childProofThreshold = std::min(proofThreshold, secondBestNumber + 1);
+			childDisproofThreshold = disproofThreshold - disproofNumber + bestChildDisproofNumber;
 		}
 		else
 		{
+			childProofThreshold = proofThreshold - proofNumber + bestChildProofNumber;
+			childDisproofThreshold = std::min(disproofThreshold, secondBestNumber + 1);
+		}
+
+		game->PushMove(legalMoveArray[bestChild]);
+		success = this->MultipleIterativeDeepening(attackingColor, otherColor, game, depth + 1, childKeyArray[bestChild], childProofThreshold, childDisproofThreshold, childProofArray[bestChild], childDisproofArray[bestChild]);
+		game->PopMove();
+
+		if (!success)
 			break;
+	}
+
+	DeleteMoveArray(legalMoveArray);
+	return success;
+}
+
+// How many moves are left to mate changes what a position is worth, so the depth is part of the key.
+bool ChessProofNumberAI::LookUp(uint64_t positionKey, int depth, uint32_t& proofNumber, uint32_t& disproofNumber) const
+{
+	uint64_t key = positionKey ^ (uint64_t(depth + 1) * 0x9E3779B97F4A7C15ULL);
+	const Entry* entry = &this->entryArray[key & uint64_t(this->numEntries - 1)];
+	if (entry->key == key)
+	{
+		proofNumber = entry->proofNumber;
+		disproofNumber = entry->disproofNumber;
+		return true;
+	}
+
+	proofNumber = 1;
+	disproofNumber = 1;
+	return false;
+}
+
+void ChessProofNumberAI::Store(uint64_t positionKey, int depth, uint32_t proofNumber, uint32_t disproofNumber)
+{
+	uint64_t key = positionKey ^ (uint64_t(depth + 1) * 0x9E3779B97F4A7C15ULL);
+	Entry* entry = &this->entryArray[key & uint64_t(this->numEntries - 1)];
+
+	bool solved = (proofNumber == 0 || disproofNumber == 0);
+	bool entrySolved = (entry->proofNumber == 0 || entry->disproofNumber == 0);
+	if (entry->key != key && entrySolved && !solved && entry->generation == this->generation)
+		return;
+
+	entry->key = key;
+	entry->proofNumber = proofNumber;
+	entry->disproofNumber = disproofNumber;
+	entry->generation = this->generation;
+}
+
+// Follow the proof back down the tree.  The attacker plays a proven move, and the defender can play anything,
+// since it's all been proven.  If the table has forgotten part of the proof, the line just ends early.
+void ChessProofNumberAI::ExtractMatingLine(ChessColor attackingColor, ChessGame* game)
+{
+	ChessColor whoseTurn = attackingColor;
+	int numMoves = game->GetNumMoves();
+
+	for (int depth = 0; depth < this->GetMaxPlies(); depth++)
+	{
+		ChessMoveArray legalMoveArray;
+		game->GenerateAllLegalMovesForColor(whoseTurn, legalMoveArray);
+
+		ChessColor otherColor = (whoseTurn == ChessColor::Black) ? ChessColor::White : ChessColor::Black;
+		ChessMove* nextMove = nullptr;
+		for (int i = 0; i < (signed)legalMoveArray.size() && !nextMove; i++)
+		{
+			game->PushMove(legalMoveArray[i]);
+			uint32_t proofNumber = 1, disproofNumber = 1;
+			this->LookUp(game->GetHashKey(otherColor), depth + 1, proofNumber, disproofNumber);
+			game->PopMove();
+
+			if (proofNumber == 0)
+			{
+				nextMove = legalMoveArray[i];
+				legalMoveArray[i] = nullptr;
+			}
 		}
 
-		int originalNumMoves = game->GetNumMoves();
-		ChessColor whoseTurn = favoredColor;
+		DeleteMoveArray(legalMoveArray);
+
+		if (!nextMove)
+			break;
+
+		this->matingLine->push_back(nextMove->Pack());
+		game->PushMove(nextMove);
+		whoseTurn = otherColor;
+	}
+
+	while (game->GetNumMoves() > numMoves)
+		delete game->PopMove();
+}
+
+//---------------------------------------- ChessMontoCarloTreeSearchAI ----------------------------------------
+
+ChessMonteCarloTreeSearchAI::ChessMonteCarloTreeSearchAI(double maxTimeSeconds, int maxIterations)
+{
+	this->maxTimeSeconds = maxTimeSeconds;
+	this->maxIterations = maxIterations;
+	this->numGamesPerRollout = 32;
+	this->maxRolloutMoves = 0;
+	this->playoutDepth = 0;
+	this->playoutEvaluationScale = 30.0;
+	this->reuseTree = true;
+	this->maxTreeNodes = 0;
+	this->useSolver = true;
+	this->useTranspositions = false;
+	this->numSearchThreads = 1;
+	this->parallelism = Parallelism::TREE;
+	this->virtualLoss = 1.0f;
+	this->wideningCoefficient = 0.0;
+	this->wideningExponent = 0.5;
+	this->raveEquivalence = 0.0;
+	this->tree = new ChessMonteCarloTree();
+	this->helperTreeArray = new std::vector<ChessMonteCarloTree*>();
+	this->treeKept = false;
+	this->keptRootKey = 0;
+	this->keptRootNumMoves = 0;
+	this->keptRootFavoredColor = ChessColor::White;
+}
+
+/*virtual*/ ChessMonteCarloTreeSearchAI::~ChessMonteCarloTreeSearchAI()
+{
+	delete this->tree;
+
+	for (ChessMonteCarloTree* helperTree : *this->helperTreeArray)
+		delete helperTree;
+
+	delete this->helperTreeArray;
+}
+
+/*virtual*/ void ChessMonteCarloTreeSearchAI::NewGame()
+{
+	this->tree->Clear();
+	this->treeKept = false;
+}
+
+bool ChessMonteCarloTreeSearchAI::KeepReusableSubtree(ChessColor favoredColor, ChessGame* game)
+{
+	int numMovesSince = game->GetNumMoves() - this->keptRootNumMoves;
+	if (!this->treeKept || !this->reuseTree || favoredColor != this->keptRootFavoredColor || (numMovesSince != 0 && numMovesSince != 2))
+		return false;
+
+	this->treeKept = false;
+
+	// Take back whatever was played since, oldest move first, to make sure this is the game we were playing.
+	ChessMove* moveArray[2];
+	for (int i = numMovesSince - 1; i >= 0; i--)
+		moveArray[i] = game->PopMove();
+
+	bool sameGame = (game->GetHashKey(favoredColor) == this->keptRootKey);
+
+	for (int i = 0; i < numMovesSince; i++)
+		game->PushMove(moveArray[i]);
+
+	if (!sameGame)
+		return false;
+
+	ChessMonteCarloTree::NodeIndex node = this->tree->GetRoot();
+	for (int i = 0; i < numMovesSince && node != CHESS_MCTS_NULL_NODE; i++)
+		node = this->tree->FindChild(node, moveArray[i]->Pack());
 
-		//
-		// SELECTION PHASE
-		//
+	if (node == CHESS_MCTS_NULL_NODE)
+		return false;
+
+	this->tree->KeepSubtree(node);
+	return true;
+}
+
+/*virtual*/ ChessMove* ChessMonteCarloTreeSearchAI::CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game)
+{
+	if (this->progressIndicator)
+		this->progressIndicator->ProgressBegin();
 
-		Node* selectedNode = root;
-		while (selectedNode->childArray.size() > 0)
+	this->BeginSearch(favoredColor, game);
+
+	ChessMonteCarloTree* tree = this->tree;
+
+	// Making or dropping the position table throws out the tree.
+	uint32_t numPositions = this->useTranspositions ? CHESS_MCTS_POSITION_TABLE_SIZE : 0;
+	if (tree->GetPositionTableSize() != numPositions)
+	{
+		tree->SetPositionTableSize(numPositions);
+		this->treeKept = false;
+	}
+
+	// In root parallelism, the node budget is shared out between the trees.
+	int numTrees = (this->parallelism == Parallelism::ROOT && this->numSearchThreads > 1) ? this->numSearchThreads : 1;
+	uint32_t nodeBudget = (this->maxTreeNodes > 0) ? uint32_t(this->maxTreeNodes / numTrees) : CHESS_MCTS_BLOCK_SIZE * CHESS_MCTS_MAX_BLOCKS;
+	tree->SetNodeBudget(nodeBudget);
+
+	if (!this->KeepReusableSubtree(favoredColor, game))
+		tree->CreateRoot();
+	else if (tree->IsFull())
+		tree->Prune(tree->GetNodeBudget() / 2);
+
+	ChessMonteCarloTree::NodeIndex root = tree->GetRoot();
+
+	// The tree is walked on the light-weight playout board, rather than the game, since all we need of the
+	// moves in the tree is to make them.
+	ChessPlayoutBoard rootBoard;
+	rootBoard.SetFromGame(game, favoredColor);
+
+	ChessPackedMove describedMove = CHESS_PACKED_MOVE_NONE;
+	std::string bestMoveDescription;
+
+	uint64_t seed = (uint64_t(std::rand()) << 32) ^ uint64_t(std::rand()) ^ uint64_t(game->GetNumMoves());
+	uint64_t randomState = seed | 1;
+
+	// With more than one search thread, the helpers run whole iterations alongside us until we tell them to stop,
+	// and we look after the limits, progress and results as usual.  Everybody plays their own roll-outs, since the
+	// helpers are already keeping the pool busy.  Note that we mustn't wait on a task group while the helpers are
+	// going, since that can pick up one of their tasks, which wouldn't return until we stopped it.
+	int numHelpers = (this->numSearchThreads > 1) ? this->numSearchThreads - 1 : 0;
+	bool parallelRollout = (numHelpers == 0);
+	std::atomic<bool> stopHelpers(false);
+	std::atomic<uint64_t> numIterations(0);
+	std::atomic<bool> rootProven(false);
+
+	// In root parallelism, each helper starts a tree of its own, with nothing in it.  Only ours is kept from one
+	// search to the next.
+	bool rootParallel = (this->parallelism == Parallelism::ROOT);
+	if (rootParallel)
+	{
+		while ((int)this->helperTreeArray->size() < numHelpers)
+			this->helperTreeArray->push_back(new ChessMonteCarloTree());
+
+		for (int i = 0; i < numHelpers; i++)
 		{
-			Node* nextNode = nullptr;
-			double highestUCB = -DBL_MAX;
-			for (Node* child : selectedNode->childArray)
+			(*this->helperTreeArray)[i]->SetPositionTableSize(numPositions);
+			(*this->helperTreeArray)[i]->SetNodeBudget(nodeBudget);
+			(*this->helperTreeArray)[i]->CreateRoot();
+		}
+	}
+
+	ChessThreadPool::TaskGroup helperGroup;
+	for (int i = 0; i < numHelpers; i++)
+	{
+		ChessMonteCarloTree* helperTree = rootParallel ? (*this->helperTreeArray)[i] : tree;
+		helperGroup.Run([&, i, helperTree]() {
+			uint64_t helperRandomState = (seed + uint64_t(i + 2) * 0x9E3779B97F4A7C15ULL) | 1;
+			while (!stopHelpers.load(std::memory_order_relaxed))
 			{
-				double childUCB = child->CalcUCB();
-				if (childUCB > highestUCB)
+				this->PerformIteration(helperTree, favoredColor, rootBoard, helperRandomState, false);
+				numIterations.fetch_add(1, std::memory_order_relaxed);
+				if (rootParallel && helperTree->IsFull())
+					helperTree->Prune(helperTree->GetNodeBudget() / 2);
+				if (helperTree->GetProof(helperTree->GetRoot()) != ChessMonteCarloTree::Proof::UNKNOWN)
 				{
-					highestUCB = childUCB;
-					nextNode = child;
+					rootProven.store(true, std::memory_order_relaxed);
+					break;
 				}
 			}
+		});
+	}
 
-			assert(nextNode != nullptr);
-			selectedNode = nextNode;
-			game->PushMove(nextNode->move);
-			whoseTurn = (whoseTurn == ChessColor::Black) ? ChessColor::White : ChessColor::Black;
-		}
+	// Only a tree nobody else is searching can be pruned as we go.
+	bool pruneTree = (numHelpers == 0 || rootParallel);
 
-		//
-		// EXPANSION PHASE
-		//
+	int iterationCount = 0;
+	double checkpointSeconds = 0.0;
 
-		if (selectedNode->numVisits > 0.0 || selectedNode == root)
+	// The caller's own time limits are enforced by ShouldStopSearch().  We only need them here to tell our progress.
+	double limitSeconds = this->searchLimits.maxTimeSeconds;
+	if (this->searchLimits.deadlineSeconds > 0.0)
+	{
+		double deadlineSeconds = this->searchLimits.deadlineSeconds - this->searchLimits.deadlineReserveSeconds;
+		if (limitSeconds <= 0.0 || deadlineSeconds < limitSeconds)
+			limitSeconds = deadlineSeconds;
+	}
+
+	while (true)
+	{
+		if (this->ShouldStopSearch())
+			break;
+
+		iterationCount = int(numIterations.load(std::memory_order_relaxed)) + 1;
+
+		if (this->timeManager.IsActive())
 		{
-			ChessMoveArray moveArray;
-			game->GenerateAllLegalMovesForColor(whoseTurn, moveArray);
-			if (moveArray.size() > 0)
+			// The game clock takes over from our own time budget.  The iteration budget, if any, is still a cap.
+			if (this->maxIterations > 0 && iterationCount >= this->maxIterations)
+				break;
+
+			if (!this->searchLimits.ponder)
 			{
-				for (ChessMove* move : moveArray)
+				double elapsedTimeSeconds = this->GetElapsedSeconds();
+				if (elapsedTimeSeconds >= checkpointSeconds)
 				{
-					Node* node = new Node(move, selectedNode);
-					selectedNode->childArray.push_back(node);
+					// We have no iterations in the minimax sense, so we just let the time manager see how settled
+					// our choice is every so often.  That way it can stretch or cut short our thinking.
+					ChessMonteCarloTree::NodeIndex bestChild = this->ChooseRootChild(tree);
+					if (bestChild != CHESS_MCTS_NULL_NODE)
+						this->timeManager.OnIterationComplete(tree->GetMove(bestChild));
+					checkpointSeconds = elapsedTimeSeconds + this->timeManager.GetSoftLimitSeconds() / 8.0;
 				}
-
-				selectedNode = selectedNode->childArray.back();
-				game->PushMove(selectedNode->move);
-				whoseTurn = (whoseTurn == ChessColor::Black) ? ChessColor::White : ChessColor::Black;
+				if (iterationCount > 1 && this->timeManager.SoftLimitReached(elapsedTimeSeconds))
+					break;
+				if (this->progressIndicator)
+					this->progressIndicator->ProgressUpdate(float(elapsedTimeSeconds / this->timeManager.GetHardLimitSeconds()));
 			}
 		}
-		
-		//
-		// ROLLOUT PHASE
-		//
+		else if (this->maxIterations > 0)
+		{
+			if (this->progressIndicator)
+				this->progressIndicator->ProgressUpdate(float(iterationCount) / float(this->maxIterations));
+			if (iterationCount >= this->maxIterations)
+				break;
+		}
+		else if (this->maxTimeSeconds > 0.0)
+		{
+			double elapsedTimeSeconds = this->GetElapsedSeconds();
+			if (elapsedTimeSeconds > this->maxTimeSeconds)
+				break;
+			if (this->progressIndicator)
+				this->progressIndicator->ProgressUpdate(float(elapsedTimeSeconds) / float(this->maxTimeSeconds));
+		}
+		else if (this->searchLimits.maxNodes > 0)
+		{
+			if (this->progressIndicator)
+				this->progressIndicator->ProgressUpdate(float(iterationCount) / float(this->searchLimits.maxNodes));
+		}
+		else if (this->searchLimits.maxTimeSeconds > 0.0 || this->searchLimits.deadlineSeconds > 0.0)
+		{
+			if (this->progressIndicator && limitSeconds > 0.0)
+				this->progressIndicator->ProgressUpdate(float(this->GetElapsedSeconds() / limitSeconds));
+		}
+		else
+		{
+			break;
+		}
 
-		double rolloutScore = this->PerformRollout(favoredColor, whoseTurn, game);
+		this->PerformIteration(tree, favoredColor, rootBoard, randomState, parallelRollout);
+		numIterations.fetch_add(1, std::memory_order_relaxed);
+		this->nodeCount = numIterations.load(std::memory_order_relaxed);
 
-		//
-		// BACKPROPAGATION PHASE
-		//
+		if (pruneTree && tree->IsFull())
+			root = tree->Prune(tree->GetNodeBudget() / 2);
 
-		for(Node* node = selectedNode; node; node = node->parent)
+		ChessMonteCarloTree::NodeIndex bestChild = this->ChooseRootChild(tree);
+		if (bestChild != CHESS_MCTS_NULL_NODE && tree->GetNumVisits(bestChild) > 0)
 		{
-			node->totalScore += rolloutScore;
-			node->numVisits++;
-			node->cachedUCBValid = false;
-			if (node != root)
-				game->PopMove();
+			SearchResult result;
+			result.bestMove = tree->GetMove(bestChild);
+			if (result.bestMove != describedMove)
+			{
+				// Unpacking a move means generating them all, so we only do it when our mind changes.
+				ChessMove* move = game->UnpackMove(favoredColor, result.bestMove);
+				bestMoveDescription = move ? move->GetDescription() : "";
+				describedMove = result.bestMove;
+				delete move;
+			}
+			result.bestMoveDescription = bestMoveDescription;
+			result.score = int(100.0 * tree->GetTotalScore(bestChild) / tree->GetNumVisits(bestChild));
+			if (this->timeManager.IsActive())
+				result.progress = float(this->GetElapsedSeconds() / this->timeManager.GetHardLimitSeconds());
+			else if (this->maxIterations > 0)
+				result.progress = float(iterationCount) / float(this->maxIterations);
+			else if (this->maxTimeSeconds > 0.0)
+				result.progress = float(this->GetElapsedSeconds() / this->maxTimeSeconds);
+			else if (this->searchLimits.maxNodes > 0)
+				result.progress = float(iterationCount) / float(this->searchLimits.maxNodes);
+			else if (limitSeconds > 0.0)
+				result.progress = float(this->GetElapsedSeconds() / limitSeconds);
+			this->PublishResult(result);
 		}
 
-		// Make sure we leave the game state untouched after each iteration.
-		assert(game->GetNumMoves() == originalNumMoves);
+		// Once we know how the game goes from here, there's nothing more to find out.  We check this after our own
+		// iteration, so that our root has its moves, even if a helper's tree has the proof.
+		if (rootProven.load(std::memory_order_relaxed) || tree->GetProof(root) != ChessMonteCarloTree::Proof::UNKNOWN)
+			break;
+	}
+
+	stopHelpers.store(true, std::memory_order_relaxed);
+	helperGroup.Wait();
+	this->nodeCount = numIterations.load(std::memory_order_relaxed);
+
+	if (rootParallel)
+	{
+		for (int i = 0; i < numHelpers; i++)
+			this->MergeRootStatistics((*this->helperTreeArray)[i]);
 	}
 
-	// Finally, choose the move from the root with the highest total score.
+	// Finally, choose the move from the root with the highest total score, unless we know better.
 	ChessMove* bestMove = nullptr;
-	double highestTotalScore = -DBL_MAX;
-	for (Node* child : root->childArray)
+	ChessMonteCarloTree::NodeIndex bestChild = this->ChooseRootChild(tree);
+	if (bestChild != CHESS_MCTS_NULL_NODE)
+	{
+		bestMove = game->UnpackMove(favoredColor, tree->GetMove(bestChild));
+
+		// With root parallelism, the helpers may have changed our mind since we last said.
+		SearchResult result;
+		this->GetLatestResult(result);
+		result.bestMove = tree->GetMove(bestChild);
+		result.bestMoveDescription = bestMove ? bestMove->GetDescription() : "";
+		if (tree->GetNumVisits(bestChild) > 0)
+			result.score = int(100.0 * tree->GetTotalScore(bestChild) / tree->GetNumVisits(bestChild));
+		if (tree->GetProof(bestChild) == ChessMonteCarloTree::Proof::WIN)
+			result.score = 100;
+		else if (tree->GetProof(bestChild) == ChessMonteCarloTree::Proof::DRAW)
+			result.score = 0;
+		else if (tree->GetProof(bestChild) == ChessMonteCarloTree::Proof::LOSS)
+			result.score = -100;
+
+		// Our best guess at the opponent's reply is just wherever we spent the most time looking.
+		ChessMonteCarloTree::NodeIndex replyNode = tree->GetMostVisitedChild(bestChild);
+		result.ponderMove = (replyNode != CHESS_MCTS_NULL_NODE) ? tree->GetMove(replyNode) : CHESS_PACKED_MOVE_NONE;
+		this->PublishResult(result);
+	}
+	else
 	{
-		if (child->totalScore > highestTotalScore)
+		// If we ran out of time before the root was even expanded, we still owe a move.  Move ordering is all we've got.
+		ChessMoveArray legalMoveArray;
+		game->GenerateAllLegalMovesForColor(favoredColor, legalMoveArray);
+		int bestIndex = -1;
+		for (int i = 0; i < (signed)legalMoveArray.size(); i++)
 		{
-			bestMove = child->move;
-			highestTotalScore = child->totalScore;
+			if (bestIndex < 0 || legalMoveArray[i]->GetSortKey() > legalMoveArray[bestIndex]->GetSortKey())
+				bestIndex = i;
 		}
-	}
 
-	for (Node* child : root->childArray)
-		if (child->move == bestMove)
-			child->move = nullptr;
+		if (bestIndex >= 0)
+		{
+			bestMove = legalMoveArray[bestIndex];
+			legalMoveArray.erase(legalMoveArray.begin() + bestIndex);
+		}
 
-	delete root;
+		DeleteMoveArray(legalMoveArray);
 
-	for (RolloutThread* thread : *this->rolloutThreadArray)
+		if (bestMove)
+		{
+			SearchResult result;
+			this->GetLatestResult(result);
+			result.bestMove = bestMove->Pack();
+			result.bestMoveDescription = bestMove->GetDescription();
+			this->PublishResult(result);
+		}
+	}
+
+	if (this->reuseTree)
 	{
-		thread->SignalShutdown();
-		thread->WaitForThreadExit();
-		delete thread;
+		this->treeKept = true;
+		this->keptRootKey = game->GetHashKey(favoredColor);
+		this->keptRootNumMoves = game->GetNumMoves();
+		this->keptRootFavoredColor = favoredColor;
 	}
+	else
+		tree->Clear();
 
-	this->rolloutThreadArray->clear();
+	this->EndSearch();
 
 	if (this->progressIndicator)
 		this->progressIndicator->ProgressEnd();
@@ -413,6 +1917,177 @@ ChessMonteCarloTreeSearchAI::ChessMonteCarloTreeSearchAI(double maxTimeSeconds,
 	return bestMove;
 }
 
+void ChessMonteCarloTreeSearchAI::PerformIteration(ChessMonteCarloTree* tree, ChessColor favoredColor, const ChessPlayoutBoard& rootBoard, uint64_t& randomState, bool parallelRollout)
+{
+	ChessMonteCarloTree::NodeIndex root = tree->GetRoot();
+	ChessPlayoutBoard board = rootBoard;
+	float virtualLoss = this->virtualLoss;
+
+	//
+	// SELECTION PHASE
+	//
+
+	// Every node on the way down is counted as visited, and lost by whoever moved there, until we know better.
+	// That steers any other threads searching the tree away from the line we're on.  With just the one thread,
+	// it's all taken back before anyone else looks.
+	ChessMonteCarloTree::NodeIndex selectedNode = root;
+	uint32_t priorNumVisits = tree->AddVisit(selectedNode, -virtualLoss);
+	while (tree->GetNumChildren(selectedNode) > 0)
+	{
+		selectedNode = this->SelectChild(tree, selectedNode);
+		board.MakeMove(board.UnpackMove(tree->GetMove(selectedNode)));
+		if (tree->NeedsPosition(selectedNode))
+			tree->LinkPosition(selectedNode, board.GetHashKey());
+		priorNumVisits = tree->AddVisit(selectedNode, -virtualLoss);
+
+		// There's nothing to learn below a node whose outcome we already know.  It's backed up as it is.
+		if (tree->GetProof(selectedNode) != ChessMonteCarloTree::Proof::UNKNOWN)
+			break;
+	}
+
+	//
+	// EXPANSION PHASE
+	//
+
+	// If someone else is already expanding the node, we just play out from it.  There's no expanding a node
+	// whose outcome we already know.
+	if ((priorNumVisits > 0 || selectedNode == root) && tree->GetProof(selectedNode) == ChessMonteCarloTree::Proof::UNKNOWN && tree->BeginExpansion(selectedNode))
+	{
+		ChessPlayoutMove moveArray[CHESS_PLAYOUT_MAX_MOVES];
+		int numMoves = board.GenerateLegalMoves(moveArray);
+
+		// A bare king against a bare king is as good as over, though we always give the root its moves.
+		bool insufficientMaterial = (board.numPieces <= 2 && selectedNode != root);
+
+		if (numMoves == 0 || insufficientMaterial)
+		{
+			tree->CancelExpansion(selectedNode);
+
+			// Whoever moved here won if the other side is mated, and otherwise, it's a draw.  Note that the
+			// root can't be proven this way, since it has no move and the game would already be over.
+			if (this->useSolver && selectedNode != root)
+			{
+				bool checkmate = (numMoves == 0 && board.IsInCheck(board.whoseTurn));
+				tree->SetProof(selectedNode, checkmate ? ChessMonteCarloTree::Proof::WIN : ChessMonteCarloTree::Proof::DRAW);
+				tree->PropagateProof(selectedNode);
+			}
+		}
+		else
+		{
+			// With widening, the order matters, and the first move is the one we go on to.
+			int chosenMoveIndex = numMoves - 1;
+			if (this->wideningCoefficient > 0.0)
+			{
+				std::stable_sort(moveArray, moveArray + numMoves, [&board](const ChessPlayoutMove& moveA, const ChessPlayoutMove& moveB) {
+					return board.GetMovePriority(moveA) > board.GetMovePriority(moveB);
+				});
+				chosenMoveIndex = 0;
+			}
+
+			ChessPackedMove packedMoveArray[CHESS_PLAYOUT_MAX_MOVES];
+			for (int i = 0; i < numMoves; i++)
+				packedMoveArray[i] = moveArray[i].Pack();
+
+			// If the tree is full, we just carry on from where we are.
+			ChessMonteCarloTree::NodeIndex firstChild = tree->AddChildren(selectedNode, packedMoveArray, numMoves);
+			if (firstChild != CHESS_MCTS_NULL_NODE)
+			{
+				selectedNode = firstChild + chosenMoveIndex;
+				board.MakeMove(moveArray[chosenMoveIndex]);
+				if (tree->NeedsPosition(selectedNode))
+					tree->LinkPosition(selectedNode, board.GetHashKey());
+				tree->AddVisit(selectedNode, -virtualLoss);
+			}
+		}
+	}
+	
+	//
+	// ROLLOUT PHASE
+	//
+
+	// For RAVE, we need to know what happened in each game.
+	std::vector<ChessPlayoutMoveSet> moveSetArray;
+	std::vector<double> gameResultArray;
+
+	// A leaf whose outcome we know doesn't need playing out.
+	double rolloutScore = 0.0;
+	ChessMonteCarloTree::Proof leafProof = tree->GetProof(selectedNode);
+	if (leafProof == ChessMonteCarloTree::Proof::UNKNOWN)
+	{
+		if (this->raveEquivalence > 0.0)
+		{
+			moveSetArray.resize(this->numGamesPerRollout);
+			gameResultArray.resize(this->numGamesPerRollout);
+			rolloutScore = this->PerformRollout(favoredColor, board, randomState, parallelRollout, moveSetArray.data(), gameResultArray.data());
+		}
+		else
+			rolloutScore = this->PerformRollout(favoredColor, board, randomState, parallelRollout);
+	}
+	else if (leafProof != ChessMonteCarloTree::Proof::DRAW)
+	{
+		bool favoredColorMovedHere = (board.whoseTurn != favoredColor);
+		rolloutScore = ((leafProof == ChessMonteCarloTree::Proof::WIN) == favoredColorMovedHere) ? 1.0 : -1.0;
+	}
+
+	//
+	// BACKPROPAGATION PHASE
+	//
+
+	// Whoever is to move at the leaf didn't make the move that got us there.  Going up the tree, the
+	// player who made each move alternates.  The visits were already counted on the way down.
+	ChessColor moverColor = (board.whoseTurn == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+	for (ChessMonteCarloTree::NodeIndex node = selectedNode; node != CHESS_MCTS_NULL_NODE; node = tree->GetParent(node))
+	{
+		tree->AddScore(node, float((moverColor == favoredColor) ? rolloutScore : -rolloutScore) + virtualLoss);
+		moverColor = (moverColor == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+	}
+
+	if (moveSetArray.size() > 0)
+	{
+		ChessColor leafMoverColor = (board.whoseTurn == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+		this->UpdateAMAFStatistics(tree, selectedNode, leafMoverColor, favoredColor, moveSetArray.data(), gameResultArray.data());
+	}
+}
+
+void ChessMonteCarloTreeSearchAI::UpdateAMAFStatistics(ChessMonteCarloTree* tree, ChessMonteCarloTree::NodeIndex leafNode, ChessColor leafMoverColor, ChessColor favoredColor, const ChessPlayoutMoveSet* moveSetArray, const double* gameResultArray)
+{
+	// Going up, we collect the moves made in the tree below where we are, which every game made too.
+	ChessPlayoutMoveSet treeMoveSet;
+	treeMoveSet.Clear();
+
+	ChessColor moverColor = leafMoverColor;
+	for (ChessMonteCarloTree::NodeIndex node = leafNode; tree->GetParent(node) != CHESS_MCTS_NULL_NODE; node = tree->GetParent(node))
+	{
+		treeMoveSet.Add(moverColor, tree->GetMove(node));
+
+		// The node and its siblings are all moves of the same side.
+		ChessMonteCarloTree::NodeIndex parentNode = tree->GetParent(node);
+		ChessMonteCarloTree::NodeIndex firstChild = tree->GetFirstChild(parentNode);
+		int numChildren = tree->GetNumChildren(parentNode);
+		for (int i = 0; i < numChildren; i++)
+		{
+			ChessPackedMove move = tree->GetMove(firstChild + i);
+			bool madeInTree = treeMoveSet.Contains(moverColor, move);
+
+			uint32_t numAMAFVisits = 0;
+			double totalAMAFScore = 0.0;
+			for (int j = 0; j < this->numGamesPerRollout; j++)
+			{
+				if (madeInTree || moveSetArray[j].Contains(moverColor, move))
+				{
+					numAMAFVisits++;
+					totalAMAFScore += (moverColor == favoredColor) ? gameResultArray[j] : -gameResultArray[j];
+				}
+			}
+
+			if (numAMAFVisits > 0)
+				tree->AddAMAFStatistics(firstChild + i, numAMAFVisits, float(totalAMAFScore));
+		}
+
+		moverColor = (moverColor == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+	}
+}
+
 // MCTS has some re-enforcement learning built into it, but the main principle upon which it is built is
 // the law of large numbers.  Specifically, the more random samples we take of a board position (in the form
 // of playing random games from it all the way to the very end), the more accurate becomes our view of how
@@ -426,153 +2101,145 @@ ChessMonteCarloTreeSearchAI::ChessMonteCarloTreeSearchAI(double maxTimeSeconds,
 // considering, then you would just know which one is the best.  The tree, however, can help us take more samples
 // where there's more promise, and the UCB stuff can help us keep exploring so that we don't overlook other areas
 // of the game tree.  Anyhow, that's my current understanding of all this.
-double ChessMonteCarloTreeSearchAI::PerformRollout(ChessColor favoredColor, ChessColor whoseTurn, ChessGame* game)
+double ChessMonteCarloTreeSearchAI::PerformRollout(ChessColor favoredColor, const ChessPlayoutBoard& board, uint64_t& randomState, bool runInParallel, ChessPlayoutMoveSet* moveSetArray /*= nullptr*/, double* gameResultArray /*= nullptr*/)
 {
 	assert(this->numGamesPerRollout > 0);
 
-	double gameResultsTotal = 0.0;
-	int numGamesPlayed = 0;
-	Mutex gameResultMutex;
-	std::function<void(double)> aggregateGameResultFunc = [&](double gameResultValue) {
-		MutexLocker locker(gameResultMutex);
-		gameResultsTotal += gameResultValue;
-		numGamesPlayed++;
+	auto playGame = [this, favoredColor](ChessPlayoutBoard playoutBoard, uint64_t& gameRandomState, ChessPlayoutMoveSet* moveSet) -> double {
+		if (moveSet)
+			moveSet->Clear();
+
+		if (this->playoutDepth <= 0)
+			return playoutBoard.PlayRandomGame(favoredColor, this->maxRolloutMoves, gameRandomState, moveSet);
+
+		// Playing just a few moves and then taking a guess lets us take a lot more samples than playing whole games.
+		// Random games are long and mostly meaningless by the end, so each sample is worth about as much anyway.
+		double gameResult = 0.0;
+		if (!playoutBoard.PlayRandomMoves(favoredColor, this->playoutDepth, gameRandomState, gameResult, moveSet))
+			gameResult = ::tanh(double(this->PlayoutEvaluationFunction(favoredColor, playoutBoard)) / this->playoutEvaluationScale);
+		return gameResult;
 	};
 
-	// Evenly distribute the workload of performing all the games per roll-out.
-	// Each thread gets a copy of the game, so there is no need to unwind the move stack after each game.
-	std::vector<Event*> completionEventArray;
-	for (int i = 0; i < this->numGamesPerRollout; i++)
+	double gameResultsTotal = 0.0;
+
+	if (!runInParallel)
 	{
-		int j = i % this->rolloutThreadArray->size();
-		RolloutThread* thread = (*this->rolloutThreadArray)[j];
-		Event* completionEvent = new Event();
-		RolloutThread::Work work{ favoredColor, whoseTurn, game->Clone(), aggregateGameResultFunc, completionEvent };
-		thread->EnqueueRandomGame(work);
-		completionEventArray.push_back(completionEvent);
+		for (int i = 0; i < this->numGamesPerRollout; i++)
+		{
+			double gameResult = playGame(board, randomState, moveSetArray ? &moveSetArray[i] : nullptr);
+			if (gameResultArray)
+				gameResultArray[i] = gameResult;
+			gameResultsTotal += gameResult;
+		}
 	}
+	else
+	{
+		// Each game gets its own slot, so nobody has to lock anything to report their result.  Each task gets its
+		// own copy of the board, which is just a memcpy, and its own random number sequence, so they don't fight over it.
+		uint64_t seed = randomState;
+		ChessPlayoutBoard::NextRandom(randomState);
+		std::vector<double> localGameResultArray;
+		if (!gameResultArray)
+		{
+			localGameResultArray.resize(this->numGamesPerRollout, 0.0);
+			gameResultArray = localGameResultArray.data();
+		}
+		ChessThreadPool::TaskGroup taskGroup;
+		for (int i = 0; i < this->numGamesPerRollout; i++)
+		{
+			taskGroup.Run([=]() {
+				uint64_t gameRandomState = (seed + uint64_t(i + 1) * 0x9E3779B97F4A7C15ULL) | 1;
+				gameResultArray[i] = playGame(board, gameRandomState, moveSetArray ? &moveSetArray[i] : nullptr);
+			});
+		}
 
-	Event::WaitMultiple(completionEventArray);
+		taskGroup.Wait();
 
-	for (Event* completionEvent : completionEventArray)
-		delete completionEvent;
+		for (int i = 0; i < this->numGamesPerRollout; i++)
+			gameResultsTotal += gameResultArray[i];
+	}
 
 	return gameResultsTotal / double(this->numGamesPerRollout);
 }
 
-//---------------------------------------- ChessMontoCarloTreeSearchAI::Node ----------------------------------------	
-	
-ChessMonteCarloTreeSearchAI::Node::Node(ChessMove* move, Node* parent)
+uint32_t ChessMonteCarloTreeSearchAI::GetTreeNodeCount() const
 {
-	this->move = move;
-	this->parent = parent;
-	this->totalScore = 0.0;
-	this->numVisits = 0.0;
-	this->cachedUCB = DBL_MAX;
-	this->cachedUCBValid = true;
+	return this->tree->GetNumNodes();
 }
 
-/*virtual*/ ChessMonteCarloTreeSearchAI::Node::~Node()
+size_t ChessMonteCarloTreeSearchAI::GetTreeMemoryUsage() const
 {
-	delete this->move;
+	return this->tree->GetMemoryUsage();
+}
 
-	for (Node* child : this->childArray)
-		delete child;
+/*virtual*/ int ChessMonteCarloTreeSearchAI::PlayoutEvaluationFunction(ChessColor favoredColor, const ChessPlayoutBoard& board)
+{
+	return board.Evaluate(favoredColor);
 }
 
-double ChessMonteCarloTreeSearchAI::Node::CalcUCB() const
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTreeSearchAI::SelectChild(const ChessMonteCarloTree* tree, ChessMonteCarloTree::NodeIndex node) const
 {
-	if (!this->cachedUCBValid)
-	{
-		if (this->numVisits == 0.0 || !this->parent)
-			this->cachedUCB = DBL_MAX;
-		else
-		{
-			static double C = 2.0;
-			double exploitationTerm = this->totalScore / this->numVisits;
-			double explorationTerm = C * ::sqrt(::log(this->parent->numVisits) / this->numVisits);
-			this->cachedUCB = explorationTerm + exploitationTerm;
-		}
+	static float C = 2.0f;
 
-		this->cachedUCBValid = true;
+	// The children are in order of promise, so widening just means looking at fewer of them.
+	int numChildren = tree->GetNumChildren(node);
+	if (this->wideningCoefficient > 0.0)
+	{
+		double numWidenedChildren = ::ceil(this->wideningCoefficient * ::pow(double(tree->GetNumVisits(node)), this->wideningExponent));
+		if (numWidenedChildren < double(numChildren))
+			numChildren = (numWidenedChildren < 1.0) ? 1 : int(numWidenedChildren);
 	}
 
-	return this->cachedUCB;
+	return tree->SelectChildByUCB(node, numChildren, C, float(this->raveEquivalence));
 }
 
-//---------------------------------------- ChessMontoCarloTreeSearchAI::RolloutThread ----------------------------------------	
-
-ChessMonteCarloTreeSearchAI::RolloutThread::RolloutThread() : workQueueSem(128)
+void ChessMonteCarloTreeSearchAI::MergeRootStatistics(const ChessMonteCarloTree* helperTree)
 {
-}
+	ChessMonteCarloTree::NodeIndex root = this->tree->GetRoot();
+	ChessMonteCarloTree::NodeIndex helperRoot = helperTree->GetRoot();
 
-/*virtual*/ ChessMonteCarloTreeSearchAI::RolloutThread::~RolloutThread()
-{
-}
+	// Both trees generated their moves at the root from the same position, but we don't count on them being in
+	// the same order.  Of course, if we never got around to expanding our root, there's nowhere to put anything.
+	this->tree->AddStatistics(root, helperTree->GetNumVisits(helperRoot), helperTree->GetTotalScore(helperRoot));
 
-void ChessMonteCarloTreeSearchAI::RolloutThread::EnqueueRandomGame(const Work& work)
-{
-	this->workQueue.AddTail(work);
-	this->workQueueSem.Increment();
-}
+	ChessMonteCarloTree::NodeIndex helperFirstChild = helperTree->GetFirstChild(helperRoot);
+	int numHelperChildren = helperTree->GetNumChildren(helperRoot);
+	for (int i = 0; i < numHelperChildren; i++)
+	{
+		ChessMonteCarloTree::NodeIndex helperChild = helperFirstChild + i;
+		ChessMonteCarloTree::NodeIndex child = this->tree->FindChild(root, helperTree->GetMove(helperChild));
+		if (child != CHESS_MCTS_NULL_NODE)
+		{
+			this->tree->AddStatistics(child, helperTree->GetNumVisits(helperChild), helperTree->GetTotalScore(helperChild));
 
-void ChessMonteCarloTreeSearchAI::RolloutThread::SignalShutdown()
-{
-	Work work{ ChessColor::Black, ChessColor::Black, nullptr, [](double) {} };
-	this->workQueue.AddTail(work);
-	this->workQueueSem.Increment();
+			// What's proven is true of the position, no matter which tree proved it.
+			if (this->tree->GetProof(child) == ChessMonteCarloTree::Proof::UNKNOWN)
+				this->tree->SetProof(child, helperTree->GetProof(helperChild));
+		}
+	}
 }
 
-/*virtual*/ int ChessMonteCarloTreeSearchAI::RolloutThread::ThreadFunc()
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTreeSearchAI::ChooseRootChild(const ChessMonteCarloTree* tree) const
 {
-	while (true)
+	ChessMonteCarloTree::NodeIndex root = tree->GetRoot();
+	ChessMonteCarloTree::NodeIndex bestChild = CHESS_MCTS_NULL_NODE;
+	ChessMonteCarloTree::NodeIndex firstChild = tree->GetFirstChild(root);
+	int numChildren = tree->GetNumChildren(root);
+	for (int i = 0; i < numChildren; i++)
 	{
-		this->workQueueSem.Decrement();
-		
-		Work work;
-		if (!this->workQueue.RemoveHead(work) || !work.game)
-			break;
-
-		// TODO: Could we maybe get better results if instead of playing to the end of the game, we
-		//       just played about 3 or 4 moves ahead?  This would allow us to play many, many more
-		//       games (or partial games) per rollout, and then maybe give a more accurate estimation
-		//       of the value of the position.  This would add back an evaluation function, though,
-		//       and the theory of MCTS is that random playouts (to the very end) replace the traditional
-		//       evaluation function.  I don't know.  I think I've just completely failed to apply the
-		//       MCTS technique to Chess.  I'm ready to give up for a while.  Maybe revisit this later.
-		double gameResultValue = 0.0;
-		while (true)
-		{
-			ChessMoveArray moveArray;
-			GameResult result = work.game->GenerateAllLegalMovesForColor(work.whoseTurn, moveArray);
-
-			// Have we reached the end of the game?
-			if (result == GameResult::CheckMate)
-			{
-				gameResultValue = (work.whoseTurn == work.favoredColor) ? -1.0 : 1.0;
-				DeleteMoveArray(moveArray);
-				break;
-			}
-			else if (result == GameResult::StaleMate || work.game->GetNumPiecesOnBoard() <= 2)
-			{
-				gameResultValue = 0.0;
-				DeleteMoveArray(moveArray);
-				break;
-			}
-
-			// Pick a random move and go with it.
-			int i = Random(0, moveArray.size() - 1);
-			ChessMove* move = moveArray[i];
-			moveArray[i] = moveArray[moveArray.size() - 1];
-			moveArray.pop_back();
-			DeleteMoveArray(moveArray);
-			work.game->PushMove(move);
-			work.whoseTurn = (work.whoseTurn == ChessColor::Black) ? ChessColor::White : ChessColor::Black;
-		}
-
-		work.aggregateGameResultFunc(gameResultValue);
-		work.completionEvent->Signal();
+		ChessMonteCarloTree::NodeIndex child = firstChild + i;
+		ChessMonteCarloTree::Proof proof = tree->GetProof(child);
+		if (proof == ChessMonteCarloTree::Proof::WIN)
+			return child;
+		if (proof == ChessMonteCarloTree::Proof::LOSS)
+			continue;
+		if (bestChild == CHESS_MCTS_NULL_NODE || tree->GetTotalScore(child) > tree->GetTotalScore(bestChild))
+			bestChild = child;
 	}
 
-	return 0;
+	// If everything loses, we might as well go by the statistics, which favor putting up a fight.
+	if (bestChild == CHESS_MCTS_NULL_NODE)
+		bestChild = tree->GetBestChild(root);
+
+	return bestChild;
 }
\ No newline at end of file
@@ -2,11 +2,18 @@
 
 #include "ChessCommon.h"
 #include "ChessUtils.h"
+#include "ChessTimeManager.h"
+#include "ChessTranspositionTable.h"
+#include "ChessMonteCarloTree.h"
+#include <atomic>
+#include <chrono>
 
 namespace ChessEngine
 {
 	class ChessGame;
 	class ChessMove;
+	class ChessPlayoutBoard;
+	struct ChessPlayoutMoveSet;
 
 	class CHESS_ENGINE_API ChessAIProgressIndicator
 	{
@@ -33,7 +40,158 @@ namespace ChessEngine
 		// Derivatives of this class might implement a different evaluation function.
 		virtual int EvaluationFunction(ChessColor favoredColor, const ChessGame* game);
 
+		// An AI may hang on to what it learned while thinking about one move to help it think about the next.
+		// Call this when the game it's playing is replaced by a new or loaded one.
+		virtual void NewGame();
+
+		// These are applied on top of whatever knobs a particular AI has (max depth, iterations, etc.)
+		struct CHESS_ENGINE_API SearchLimits
+		{
+			SearchLimits();
+
+			double maxTimeSeconds;		// Zero or less means no limit.
+			bool ponder;				// Search on the opponent's time.  Limits don't apply until a ponder-hit.
+
+			// If given, the time manager works out how long to think from what's left on our clock.
+			double whiteTimeSeconds;
+			double blackTimeSeconds;
+			double whiteIncrementSeconds;
+			double blackIncrementSeconds;
+			int movesToGo;				// Moves until the next time control; zero or less if sudden death.
+
+			// In deadline mode, we must come back with a move this many seconds into the search, however hard the
+			// position.  The clock is only looked at every so many nodes, so we aim to finish the reserve early.
+			double deadlineSeconds;		// Zero or less means no deadline.
+			double deadlineReserveSeconds;
+
+			// Unlike time, a node budget costs about the same from one position to the next.  What a node is
+			// depends on the AI.  For minimax, it's a position visited.  For MCTS, it's one iteration.
+			uint64_t maxNodes;			// Zero means no limit.
+		};
+
+		// A snapshot of where a search stands.  It can be polled while the search is still running.
+		struct CHESS_ENGINE_API SearchResult
+		{
+			SearchResult();
+
+			ChessPackedMove bestMove;
+			ChessPackedMove ponderMove;		// The reply we expect to the best move, if we have any idea.
+			std::string bestMoveDescription;
+			int score;
+			int depth;
+			uint64_t nodeCount;
+			double elapsedSeconds;
+			float progress;
+			bool complete;
+			double slackSeconds;			// How far under the deadline we finished, if there was one.  Negative if we missed it.
+			std::vector<int> passesPerDepth;	// For searches that may take more than one pass at each depth.
+			int failHighCount;				// How many of those extra passes were because the value was higher than we thought...
+			int failLowCount;				// ...and how many because it was lower.
+		};
+
+		// This is what you get back from the non-blocking search API.  The search runs on a thread owned by
+		// the handle, against its own copy of the game, so the caller's game can be touched freely meanwhile.
+		// Deleting the handle stops the search and waits for the thread to finish.  The completion callback runs on
+		// that very thread, so it must not delete the handle; it can't wait for itself.
+		class CHESS_ENGINE_API SearchHandle
+		{
+			friend class ChessAI;
+
+		public:
+			typedef std::function<void(SearchHandle* handle)> CompletionCallback;
+
+			virtual ~SearchHandle();
+
+			// This is just an atomic store; the search notices it the next time it polls.
+			void Stop();
+
+			bool IsComplete() const;
+			void Wait();
+
+			// Tell a ponder search that the opponent played the move we were pondering.  From here on, it's
+			// just a normal search, and its limits are measured from now.  On a miss, just delete the handle.
+			void PonderHit();
+			ChessPackedMove GetPonderMove() const;
+
+			// While the search is running, this is the latest it's published.  Once complete, it's the final result.
+			void GetResult(SearchResult& result);
+
+			// Once complete, the caller can take ownership of the recommended move.  It may be null.
+			ChessMove* TakeBestMove();
+
+		private:
+			SearchHandle(ChessAI* ai, ChessColor favoredColor, ChessGame* game, CompletionCallback completionCallback);
+
+			class SearchThread : public Thread
+			{
+			public:
+				SearchThread(SearchHandle* handle);
+				virtual ~SearchThread();
+
+				virtual int ThreadFunc() override;
+
+				SearchHandle* handle;
+			};
+
+			ChessAI* ai;
+			ChessColor favoredColor;
+			ChessGame* game;
+			ChessMove* bestMove;
+			ChessPackedMove ponderMove;
+			std::atomic<bool> stopFlag;
+			std::atomic<bool> ponderHitFlag;
+			std::atomic<bool> complete;
+			SearchResult result;			// The final result, once complete, so that a later search can't overwrite it.
+			CompletionCallback completionCallback;
+			SearchThread thread;
+		};
+
+		// Kick off a search on an engine-owned thread and return immediately.  Only one search can be in
+		// flight per AI instance, so this returns null if one is already running.  Note that the completion
+		// callback and any progress indicator get called from the search thread, not the calling thread.
+		SearchHandle* StartSearch(ChessColor favoredColor, const ChessGame* game, const SearchLimits& limits, SearchHandle::CompletionCallback completionCallback = nullptr);
+
+		// Having just recommended a move for the favored color, start thinking about our next move as if the opponent
+		// had already replied with the given move (usually the ponder move of our last result.)  The given game should
+		// have our move on it, but not the reply.  This returns null if the reply isn't legal.
+		SearchHandle* StartPonder(ChessColor favoredColor, const ChessGame* game, ChessPackedMove predictedReply, const SearchLimits& limits, SearchHandle::CompletionCallback completionCallback = nullptr);
+
+		void GetLatestResult(SearchResult& result);
+
 		ChessAIProgressIndicator* progressIndicator;
+		SearchLimits searchLimits;
+		ChessTimeManager timeManager;
+
+	protected:
+
+		// Derivatives call these to bracket their search, poll for a stop, and report how they're doing.
+		// Note that the soft time limit is for the derivative to check between units of work.
+		void BeginSearch(ChessColor favoredColor, ChessGame* game);
+		void EndSearch();
+		bool ShouldStopSearch();
+		bool SoftTimeLimitReached() const;
+		void PublishResult(const SearchResult& result);
+		double GetElapsedSeconds() const;
+
+		bool searchStopped;
+		uint64_t nodeCount;
+		std::chrono::steady_clock::time_point searchStartTime;
+
+		// Reading the clock isn't free, so we only do it once every so many nodes.  Derivatives that
+		// count their nodes in big units of work should leave this at one.
+		uint64_t clockPollInterval;
+		uint64_t nextClockPollNodeCount;
+
+		// The node budget doesn't start being spent until a ponder-hit.
+		uint64_t nodeBudgetStartCount;
+
+	private:
+
+		SearchHandle* LaunchSearch(ChessColor favoredColor, ChessGame* game, const SearchLimits& limits, SearchHandle::CompletionCallback completionCallback);
+
+		Mutex resultMutex;
+		SearchResult latestResult;
+		std::atomic<SearchHandle*> activeSearch;		// Cleared by the search thread, so the busy check must be atomic.
 	};
 
 	// Useful resources:
@@ -41,10 +199,11 @@ namespace ChessEngine
 	class CHESS_ENGINE_API ChessMinimaxAI : public ChessAI
 	{
 	public:
-		ChessMinimaxAI(int maxDepth);
+		ChessMinimaxAI(int maxDepth, int transpositionTableSize = 1 << 20);
 		virtual ~ChessMinimaxAI();
 
 		virtual ChessMove* CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game) override;
+		virtual void NewGame() override;
 
 		enum class Goal
 		{
@@ -60,8 +219,65 @@ namespace ChessEngine
 
 		bool Minimax(Goal goal, ChessColor favoredColor, ChessColor whoseTurn, ChessGame* game, int depth, Score& score, Score* currentSuperScore = nullptr);
 
+		// This is how each iteration of the deepening search is done.
+		enum class SearchDriver
+		{
+			MINIMAX,		// One pass of the minimax search above.
+			MTDF,			// Several null-window passes, converging on the minimax value.
+			ASPIRATION		// An alpha-beta pass in a narrow window around the last value, widened as needed.
+		};
+
+		// Given a guess at the value, converge on the true value and put the best move in the best move array.
+		bool MTDF(ChessColor favoredColor, ChessGame* game, int& value, int& numPasses);
+		bool AspirationSearch(ChessColor favoredColor, ChessGame* game, int& value, int& numPasses);
+
+		// Return the value of the position if it's inside the (alpha, beta) window.  If it's at most alpha,
+		// the returned value is an upper bound on it; if it's at least beta, a lower bound.
+		bool AlphaBetaSearch(Goal goal, ChessColor favoredColor, ChessColor whoseTurn, ChessGame* game, int depth, int alpha, int beta, int& value, ChessPackedMove* bestMove = nullptr);
+
+		static bool IsMateValue(int value);
+
+		SearchDriver searchDriver;
+		int aspirationDelta;			// Half the width of the first window we try at each depth.  Zero or less means don't bother.
+		int aspirationGrowthFactor;		// How much the window is widened by each time we fall out of it.
 		ChessMoveArray* bestMoveArray;
+		std::vector<ChessPackedMove>* bestReplyArray;		// Parallel to the best move array.
 		int maxDepth;
+		int evaluationNoise;		// Leaf scores are randomly off by up to this much, which is a way to weaken the AI.
+
+	protected:
+
+		void UpdatePrincipalVariation(int depth, ChessPackedMove move);
+		void SetRootBestMove(ChessColor favoredColor, ChessGame* game, ChessPackedMove bestMove);
+		void OrderMoves(ChessMoveArray& moveArray, ChessColor whoseTurn, const ChessGame* game, int depth, ChessPackedMove hashMove);
+		void RecordCutoff(const ChessMove* move, ChessColor whoseTurn, const ChessGame* game, int depth, int remainingDepth);
+		void AgeSearchState(const ChessGame* game);
+
+		// We search iteratively deeper until we reach the max depth or run out of time.  This is the
+		// depth of the current iteration.
+		int searchDepth;
+
+		// This is the usual triangular table.  Row i holds the best line found from depth i on down.
+		ChessPackedMove principalVariation[CHESS_MAX_SEARCH_DEPTH][CHESS_MAX_SEARCH_DEPTH];
+		int principalVariationLength[CHESS_MAX_SEARCH_DEPTH];
+
+		// The line found by the last iteration is searched first by the next, which is a big help to the pruning.
+		ChessPackedMove previousPrincipalVariation[CHESS_MAX_SEARCH_DEPTH];
+		int previousPrincipalVariationLength;
+		bool followPrincipalVariation;
+
+		// All of the following is kept from one search to the next, and only thrown out by NewGame().
+		ChessTranspositionTable* transpositionTable;
+
+		// Quiet moves that caused a prune.  Killers are remembered per ply, history per color and from/to squares,
+		// and counter-moves per the from/to squares of the move they answered.
+		ChessPackedMove killerMove[CHESS_MAX_SEARCH_DEPTH][2];
+		int historyTable[2][CHESS_BOARD_FILES * CHESS_BOARD_RANKS][CHESS_BOARD_FILES * CHESS_BOARD_RANKS];
+		ChessPackedMove counterMove[CHESS_BOARD_FILES * CHESS_BOARD_RANKS][CHESS_BOARD_FILES * CHESS_BOARD_RANKS];
+		int lastRootNumMoves;
+
+		int aspirationFailHighCount;
+		int aspirationFailLowCount;
 	};
 
 	// Useful resources:
@@ -79,64 +295,173 @@ namespace ChessEngine
 		virtual ~ChessMonteCarloTreeSearchAI();
 
 		virtual ChessMove* CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game) override;
+		virtual void NewGame() override;
+
+		// This judges where a truncated playout left off.  By default, it scores the board the way the base
+		// EvaluationFunction does.  A derivative with its own evaluation function can get the board's snapshot,
+		// restore it into a ChessGame and call that.  Note that this gets called from the thread pool.
+		virtual int PlayoutEvaluationFunction(ChessColor favoredColor, const ChessPlayoutBoard& board);
+
+		// How big the tree is now, which is the tree kept from the last search, if any.  Root parallelism's helper
+		// trees aren't counted.
+		uint32_t GetTreeNodeCount() const;
+		size_t GetTreeMemoryUsage() const;
 
 	private:
 
-		double PerformRollout(ChessColor favoredColor, ChessColor whoseTurn, ChessGame* game);
+		// Select, expand, play out and back up, once.  This may be called from any number of threads at once.
+		void PerformIteration(ChessMonteCarloTree* tree, ChessColor favoredColor, const ChessPlayoutBoard& rootBoard, uint64_t& randomState, bool parallelRollout);
 
-		class Node
-		{
-		public:
-			Node(ChessMove* move, Node* parent);
-			virtual ~Node();
-
-			double CalcUCB() const;
-
-			Node* parent;
-			std::vector<Node*> childArray;
-			ChessMove* move;
-			double totalScore;
-			double numVisits;
-			mutable double cachedUCB;
-			mutable bool cachedUCBValid;
-		};
+		// Play some games out from the given board and return the average result for the favored color.  The games
+		// are either spread over the thread pool, or played one after another on the calling thread.  If given a
+		// move set per game, each game's result and moves are recorded too.
+		double PerformRollout(ChessColor favoredColor, const ChessPlayoutBoard& board, uint64_t& randomState, bool runInParallel, ChessPlayoutMoveSet* moveSetArray = nullptr, double* gameResultArray = nullptr);
 
-		class RolloutThread : public Thread
-		{
-		public:
-			RolloutThread();
-			virtual ~RolloutThread();
+		// Credit the AMAF statistics of every child, of every node on the way from the given leaf up, whose move
+		// was made later on by the same side, in the tree or in one of the given games.
+		void UpdateAMAFStatistics(ChessMonteCarloTree* tree, ChessMonteCarloTree::NodeIndex leafNode, ChessColor leafMoverColor, ChessColor favoredColor, const ChessPlayoutMoveSet* moveSetArray, const double* gameResultArray);
 
-			virtual int ThreadFunc() override;
+		// Of the children of the given node, choose the one to visit next.
+		ChessMonteCarloTree::NodeIndex SelectChild(const ChessMonteCarloTree* tree, ChessMonteCarloTree::NodeIndex node) const;
 
-			struct Work
-			{
-				ChessColor favoredColor;
-				ChessColor whoseTurn;
-				ChessGame* game;
-				std::function<void(double)> aggregateGameResultFunc;
-				Event* completionEvent;
-			};
+		// Add what the given tree learned about the moves at its root to what we know about them in ours.
+		void MergeRootStatistics(const ChessMonteCarloTree* helperTree);
 
-			void EnqueueRandomGame(const Work& work);
-			void SignalShutdown();
+		// This is the move we'd play if we had to stop now.  A proven win beats anything; otherwise it's the highest
+		// total score, staying away from proven losses if we can.
+		ChessMonteCarloTree::NodeIndex ChooseRootChild(const ChessMonteCarloTree* tree) const;
 
-		private:
+		// If the given game is the one we last searched, with nothing played since, or with just our move and the
+		// opponent's reply played since, this cuts the tree down to the part that's still relevant and returns true.
+		// Otherwise, it returns false, and the tree should be started over.
+		bool KeepReusableSubtree(ChessColor favoredColor, ChessGame* game);
 
-			ThreadSafeList<Work> workQueue;
-			Semaphore workQueueSem;
-		};
+		// Each node's score is from the point of view of whoever made the move that got us there.  The tree is kept
+		// between searches, along with the position at its root.
+		ChessMonteCarloTree* tree;
+		std::vector<ChessMonteCarloTree*>* helperTreeArray;		// For root parallelism.  These are kept to save on allocation.
+		bool treeKept;
+		uint64_t keptRootKey;
+		int keptRootNumMoves;
+		ChessColor keptRootFavoredColor;
 
 	public:
 
 		double maxTimeSeconds;
 		int maxIterations;
-		int numGamesPerRollout;
-		int numRolloutThreads;
+		int numGamesPerRollout;		// These are spread over the engine's thread pool.
+		bool reuseTree;				// Keep the tree between moves, so that we don't start from scratch each time.
+
+		// A cap on the number of nodes in the search, and so on its memory.  In root parallelism, each tree gets an even
+		// share of it (but never less than CHESS_MCTS_MIN_NODE_BUDGET).  When a tree that only one thread is working on
+		// reaches its share, it's pruned down to half as many, in place, keeping the most visited nodes, and grows back
+		// into the memory that's freed up.  So the nodes never take more than the cap, give or take the few left unused
+		// at the end of a block.  A tree shared by several threads can't be pruned in the middle of a search, so it just
+		// stops growing.  The position table, if any, is on top of this.  Zero or less means no cap, other than the
+		// tree's own limit.
+		int maxTreeNodes;
+
+		// With the solver (MCTS-Solver), game-over positions in the tree are marked as won, lost or drawn, and what that
+		// proves is passed up the tree, minimax style.  Moves proven to lose aren't searched any further, and once the
+		// outcome at the root is known for sure, we stop and play it.
+		bool useSolver;
+
+		// Share statistics between all the nodes of the tree that reach the same position by different move orders.
+		// Selection then goes by what we know of the position a move leads to, however we got there.
+		bool useTranspositions;
+
+		// With more than one search thread, each runs whole iterations, and each plays its own roll-outs.  With
+		// just one, only the roll-outs are spread over the pool.
+		int numSearchThreads;
+
+		enum class Parallelism
+		{
+			TREE,		// Everyone works on the same tree.
+			ROOT		// Everyone grows their own tree, and we add up what they found out about our moves at the end.
+		};
+
+		Parallelism parallelism;
+
+		// In tree parallelism, a node on the line a thread is working on counts as this much of a loss until that
+		// thread comes back with a real result.
+		float virtualLoss;
+
+		// With progressive widening, a node's moves are put in order of how promising they look, and selection
+		// only considers the first ceil(coefficient * visits^exponent) of them.  As a node gets visited more, it
+		// lets in more of its moves.  The moves not yet let in are never expanded.
+		double wideningCoefficient;		// Zero or less means all moves are considered from the start.
+		double wideningExponent;
+
+		// With RAVE, each random game tells us about every move either side made in it, as if it had been made first,
+		// and that's blended into a move's average score with a weight that fades as real visits come in.  This is the
+		// number of visits, k, at which the two count about the same.  Zero or less means no RAVE.  It helps the most
+		// when there are only a few iterations to go around.
+		double raveEquivalence;
+		int maxRolloutMoves;		// A random game going on longer than this is called a draw.  Zero or less means no limit.
+
+		// If given, each playout is cut off after this many moves and the position evaluated, rather than played to
+		// the end.  The evaluation goes through tanh(score / scale) to get a result from -1 to 1 like a real game's.
+		int playoutDepth;			// Zero or less means play the whole game.
+		double playoutEvaluationScale;
+	};
+
+	// This doesn't play chess so much as answer one question: can the favored color force mate from here?  It
+	// does so with depth-first proof-number search (df-pn), which goes after whichever line looks easiest to
+	// prove or disprove, rather than looking at everything to a fixed depth.  For this one question, that's a
+	// lot cheaper than minimax.  Note that proof numbers don't say how far away the mate is, so the mating line
+	// we find is a forced mate, but not necessarily the quickest.
+	//
+	// Useful resources:
+	//		* https://www.chessprogramming.org/Proof-Number_Search
+	//		* Nagai, "Df-pn Algorithm for Searching AND/OR Trees and Its Applications" (2002)
+	class CHESS_ENGINE_API ChessProofNumberAI : public ChessAI
+	{
+	public:
+		// The given number of mating moves is the N in "mate in N."  Zero or less means as deep as we can go.
+		ChessProofNumberAI(int maxMateMoves, int tableSize = 1 << 20);
+		virtual ~ChessProofNumberAI();
+
+		// This only returns a move if it's the first move of a forced mate.  Use the search limits to cap the nodes or time.
+		virtual ChessMove* CalculateRecommendedMove(ChessColor favoredColor, ChessGame* game) override;
+		virtual void NewGame() override;
+
+		enum class Proof
+		{
+			UNKNOWN,		// We ran out of nodes or time.
+			PROVEN,			// The favored color can force mate.
+			DISPROVEN		// It can't, at least not within the given number of moves.
+		};
+
+		// These tell the outcome of the last search.
+		Proof proof;
+		std::vector<ChessPackedMove>* matingLine;
+
+		int maxMateMoves;
 
 	private:
 
-		typedef std::vector<RolloutThread*> RolloutThreadArray;
-		RolloutThreadArray* rolloutThreadArray;
+		struct Entry
+		{
+			uint64_t key;
+			uint32_t proofNumber;
+			uint32_t disproofNumber;
+			uint8_t generation;
+		};
+
+		// The numbers we end up with are given back as well as stored, since the table may not have room for them.
+		bool MultipleIterativeDeepening(ChessColor attackingColor, ChessColor whoseTurn, ChessGame* game, int depth, uint64_t positionKey, uint32_t proofThreshold, uint32_t disproofThreshold, uint32_t& proofNumber, uint32_t& disproofNumber);
+		bool LookUp(uint64_t positionKey, int depth, uint32_t& proofNumber, uint32_t& disproofNumber) const;
+		void Store(uint64_t positionKey, int depth, uint32_t proofNumber, uint32_t disproofNumber);
+		void ExtractMatingLine(ChessColor attackingColor, ChessGame* game);
+		int GetMaxPlies() const;
+
+		// The table is a fixed size, so it's up to us to decide what to forget.  Solved positions are worth more than unsolved ones.
+		Entry* entryArray;
+		int numEntries;
+		uint8_t generation;
+
+		// The positions on the way down to the current one.  Going back to one of these can't help the attacker.
+		// Since the table doesn't know how we got somewhere, this can, on rare occasions, hide a mate from us.
+		uint64_t pathKeyArray[CHESS_MAX_SEARCH_DEPTH];
 	};
 }
\ No newline at end of file
@@ -16,10 +16,13 @@
 #include <limits.h>
 #include <assert.h>
 #include <functional>
+#include <stdint.h>
 
 #define CHESS_BOARD_RANKS		8
 #define CHESS_BOARD_FILES		8
 
+#define CHESS_MAX_SEARCH_DEPTH	64
+
 namespace ChessEngine
 {
 	enum class ChessColor
@@ -64,6 +67,12 @@ namespace ChessEngine
 	class ChessMove;
 	typedef std::vector<ChessMove*> ChessMoveArray;
 
+	// A move boiled down to 16 bits: source square, destination square and promotion.  Unlike a ChessMove
+	// object, it isn't tied to any particular game, so it can be freely copied around and compared.
+	typedef uint16_t ChessPackedMove;
+
+#define CHESS_PACKED_MOVE_NONE		0
+
 	CHESS_ENGINE_API void DeleteMoveArray(ChessMoveArray& moveArray);
 	CHESS_ENGINE_API int Random(int min, int max);
 }
\ No newline at end of file
@@ -1,16 +1,69 @@
 #include "ChessGame.h"
 #include "ChessPiece.h"
 #include "ChessMove.h"
+#include <type_traits>
 
 using namespace ChessEngine;
 
+static_assert(std::is_trivially_copyable<ChessGameSnapshot>::value, "Snapshots must be copyable with a memcpy.");
+
+//---------------------------------------- ZobristKeys ----------------------------------------
+
+// These are generated from a fixed seed so that a position hashes the same way from one run to the next.
+struct ZobristKeys
+{
+	ZobristKeys()
+	{
+		uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+		for (int i = 0; i < 2; i++)
+			for (int j = 0; j < 6; j++)
+				for (int k = 0; k < CHESS_BOARD_FILES; k++)
+					for (int l = 0; l < CHESS_BOARD_RANKS; l++)
+						this->pieceKey[i][j][k][l] = Next(seed);
+
+		for (int i = 0; i < CHESS_BOARD_FILES; i++)
+			for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+				this->everMovedKey[i][j] = Next(seed);
+
+		for (int i = 0; i < CHESS_BOARD_FILES; i++)
+			this->enPassantKey[i] = Next(seed);
+
+		this->whiteToMoveKey = Next(seed);
+	}
+
+	// This is the splitmix64 generator.
+	static uint64_t Next(uint64_t& seed)
+	{
+		uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t pieceKey[2][6][CHESS_BOARD_FILES][CHESS_BOARD_RANKS];
+	uint64_t everMovedKey[CHESS_BOARD_FILES][CHESS_BOARD_RANKS];
+	uint64_t enPassantKey[CHESS_BOARD_FILES];
+	uint64_t whiteToMoveKey;
+};
+
+static ZobristKeys zobristKeys;
+
+//---------------------------------------- ChessGame ----------------------------------------
+
 ChessGame::ChessGame()
 {
 	this->chessMoveStack = new ChessMoveArray();
+	this->baseEnPassantFile = -1;
 
 	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+	{
 		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+		{
 			this->boardMatrix[i][j] = nullptr;
+			this->moveFromCount[i][j] = 0;
+		}
+	}
 }
 
 /*virtual*/ ChessGame::~ChessGame()
@@ -40,6 +93,12 @@ void ChessGame::Clear()
 		delete (*this->chessMoveStack)[i];
 
 	this->chessMoveStack->clear();
+
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+			this->moveFromCount[i][j] = 0;
+
+	this->baseEnPassantFile = -1;
 }
 
 void ChessGame::Reset()
@@ -151,6 +210,8 @@ void ChessGame::Reset()
 		this->chessMoveStack->push_back(move);
 		if (!move->ReadFromStream(stream))
 			return false;
+		if (this->IsLocationValid(move->sourceLocation))
+			this->moveFromCount[move->sourceLocation.file][move->sourceLocation.rank]++;
 	}
 
 	return true;
@@ -186,9 +247,86 @@ ChessGame* ChessGame::Clone() const
 	ChessGame* game = new ChessGame();
 	game->ReadFromStream(inputStream);
 
+	// The stream doesn't know about anything a snapshot left us with, so copy that over directly.
+	game->baseEnPassantFile = this->baseEnPassantFile;
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+			game->moveFromCount[i][j] = this->moveFromCount[i][j];
+
 	return game;
 }
 
+void ChessGame::TakeSnapshot(ChessGameSnapshot& snapshot, ChessColor whoseTurn, int maxHistoryHashes /*= 0*/)
+{
+	snapshot.everMovedMask = 0;
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+	{
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+		{
+			const ChessPiece* piece = this->boardMatrix[i][j];
+			int8_t code = piece ? int8_t(int(piece->GetCode()) - int(Code::EMPTY)) : 0;
+			snapshot.squareArray[i][j] = (piece && piece->color == ChessColor::Black) ? -code : code;
+
+			if (this->moveFromCount[i][j] > 0)
+				snapshot.everMovedMask |= uint64_t(1) << (j * CHESS_BOARD_FILES + i);
+		}
+	}
+
+	snapshot.enPassantFile = int8_t(this->GetEnPassantFile());
+
+	// To get the keys of earlier positions, we have to go back to them.
+	if (maxHistoryHashes > CHESS_SNAPSHOT_MAX_HISTORY)
+		maxHistoryHashes = CHESS_SNAPSHOT_MAX_HISTORY;
+	if (maxHistoryHashes > this->GetNumMoves())
+		maxHistoryHashes = this->GetNumMoves();
+
+	snapshot.numHistoryHashes = maxHistoryHashes;
+
+	ChessMoveArray poppedMoveArray;
+	ChessColor historyTurn = whoseTurn;
+	for (int i = maxHistoryHashes - 1; i >= 0; i--)
+	{
+		poppedMoveArray.push_back(this->PopMove());
+		historyTurn = (historyTurn == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+		snapshot.historyHashArray[i] = this->GetHashKey(historyTurn);
+	}
+
+	while (poppedMoveArray.size() > 0)
+	{
+		this->PushMove(poppedMoveArray.back());
+		poppedMoveArray.pop_back();
+	}
+}
+
+void ChessGame::RestoreSnapshot(const ChessGameSnapshot& snapshot)
+{
+	this->Clear();
+
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+	{
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+		{
+			int8_t code = snapshot.squareArray[i][j];
+			if (code != 0)
+			{
+				ChessColor color = (code < 0) ? ChessColor::Black : ChessColor::White;
+				ChessPiece* piece = dynamic_cast<ChessPiece*>(ChessObject::Factory(Code(int(Code::EMPTY) + ::abs(code))));
+				assert(piece != nullptr);
+				if (piece)
+				{
+					piece->color = color;
+					this->SetSquareOccupant(ChessVector(i, j), piece);
+				}
+			}
+
+			if ((snapshot.everMovedMask & (uint64_t(1) << (j * CHESS_BOARD_FILES + i))) != 0)
+				this->moveFromCount[i][j] = 1;
+		}
+	}
+
+	this->baseEnPassantFile = snapshot.enPassantFile;
+}
+
 bool ChessGame::IsLocationValid(const ChessVector& location) const
 {
 	if (location.file < 0 || location.file >= CHESS_BOARD_FILES)
@@ -231,6 +369,7 @@ bool ChessGame::PushMove(ChessMove* move)
 	}
 
 	this->chessMoveStack->push_back(move);
+	this->moveFromCount[move->sourceLocation.file][move->sourceLocation.rank]++;
 	return true;
 }
 
@@ -250,6 +389,7 @@ ChessMove* ChessGame::PopMove()
 	}
 
 	this->chessMoveStack->pop_back();
+	this->moveFromCount[move->sourceLocation.file][move->sourceLocation.rank]--;
 	return move;
 }
 
@@ -309,6 +449,26 @@ GameResult ChessGame::GenerateAllLegalMovesForColor(ChessColor color, ChessMoveA
 	return GameResult::None;
 }
 
+ChessMove* ChessGame::UnpackMove(ChessColor color, ChessPackedMove packedMove)
+{
+	ChessMove* foundMove = nullptr;
+
+	ChessMoveArray moveArray;
+	this->GenerateAllLegalMovesForColor(color, moveArray);
+	for (int i = 0; i < (signed)moveArray.size(); i++)
+	{
+		if (moveArray[i]->Pack() == packedMove)
+		{
+			foundMove = moveArray[i];
+			moveArray[i] = nullptr;
+			break;
+		}
+	}
+
+	DeleteMoveArray(moveArray);
+	return foundMove;
+}
+
 bool ChessGame::KingMovesAcrossThreatenedSquare(const Castle* castle)
 {
 	bool indeed = false;
@@ -388,14 +548,65 @@ const ChessMove* ChessGame::GetMove(int i) const
 
 bool ChessGame::PieceEverMovedFromLocation(const ChessVector& location) const
 {
-	for (int i = 0; i < (signed)this->chessMoveStack->size(); i++)
+	if (!this->IsLocationValid(location))
+		return false;
+
+	return this->moveFromCount[location.file][location.rank] > 0;
+}
+
+int ChessGame::GetEnPassantFile() const
+{
+	if (this->chessMoveStack->size() == 0)
+		return this->baseEnPassantFile;
+
+	// An en-passant capture is only ever possible right after a pawn makes a double step.
+	const Travel* travel = dynamic_cast<const Travel*>(this->chessMoveStack->back());
+	if (travel && ::abs(travel->destinationLocation.rank - travel->sourceLocation.rank) == 2 && dynamic_cast<const Pawn*>(this->GetSquareOccupant(travel->destinationLocation)))
+		return travel->destinationLocation.file;
+
+	return -1;
+}
+
+uint64_t ChessGame::GetHashKey(ChessColor whoseTurn) const
+{
+	uint64_t hashKey = 0;
+
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
 	{
-		const ChessMove* move = (*this->chessMoveStack)[i];
-		if (move->sourceLocation == location)
-			return true;
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+		{
+			const ChessPiece* piece = this->boardMatrix[i][j];
+			if (piece)
+			{
+				int pieceIndex = int(piece->GetCode()) - int(Code::PAWN);
+				assert(0 <= pieceIndex && pieceIndex < 6);
+				hashKey ^= zobristKeys.pieceKey[int(piece->color)][pieceIndex][i][j];
+			}
+		}
+	}
+
+	// Castling rights only depend on whether the king or rooks ever left their home squares.
+	static const int homeFiles[] = { 0, 4, 7 };
+	static const int homeRanks[] = { 0, CHESS_BOARD_RANKS - 1 };
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			int file = homeFiles[i];
+			int rank = homeRanks[j];
+			if (this->moveFromCount[file][rank] > 0)
+				hashKey ^= zobristKeys.everMovedKey[file][rank];
+		}
 	}
 
-	return false;
+	int enPassantFile = this->GetEnPassantFile();
+	if (enPassantFile >= 0)
+		hashKey ^= zobristKeys.enPassantKey[enPassantFile];
+
+	if (whoseTurn == ChessColor::White)
+		hashKey ^= zobristKeys.whiteToMoveKey;
+
+	return hashKey;
 }
 
 int ChessGame::GetNumPiecesOnBoard() const
@@ -3,12 +3,28 @@
 #include "ChessCommon.h"
 #include "ChessObject.h"
 
+#define CHESS_SNAPSHOT_MAX_HISTORY		100
+
 namespace ChessEngine
 {
 	class ChessPiece;
 	class ChessMove;
 	class Castle;
 
+	// Everything about a position that matters to the rules, and nothing else, in a plain struct that can be
+	// copied with a memcpy.  It's a lot cheaper to make than a clone, because it doesn't carry the moves that
+	// got us here, just what they left behind: which squares have ever been moved from (for castling) and the
+	// file of a pawn that just made a double step (for en-passant).  If asked, it also carries the hash keys of
+	// the positions leading up to this one, oldest first, for anyone who wants to look for repetitions.
+	struct ChessGameSnapshot
+	{
+		int8_t squareArray[CHESS_BOARD_FILES][CHESS_BOARD_RANKS];		// A piece code offset from EMPTY, negated for black.
+		uint64_t everMovedMask;			// Bit rank * CHESS_BOARD_FILES + file is set if a move ever started there.
+		int8_t enPassantFile;			// Or -1 if en-passant isn't possible.
+		int32_t numHistoryHashes;
+		uint64_t historyHashArray[CHESS_SNAPSHOT_MAX_HISTORY];
+	};
+
 	class CHESS_ENGINE_API ChessGame : public ChessObject
 	{
 	public:
@@ -22,6 +38,15 @@ namespace ChessEngine
 
 		ChessGame* Clone() const;
 
+		// Capture the position with the given color to move.  Up to the given number of history hash keys are
+		// included, which means temporarily taking back that many moves, so this can't be const.  The game is
+		// left as it was found.
+		void TakeSnapshot(ChessGameSnapshot& snapshot, ChessColor whoseTurn, int maxHistoryHashes = 0);
+
+		// Replace whatever is in this game with the given position.  The game will have no moves to undo,
+		// but it still knows what it needs to about castling and en-passant rights.
+		void RestoreSnapshot(const ChessGameSnapshot& snapshot);
+
 		virtual Code GetCode() const override;
 
 		bool IsLocationValid(const ChessVector& location) const;
@@ -35,11 +60,23 @@ namespace ChessEngine
 		// Assuming it is the given color's turn, generate all legal moves for that color.
 		GameResult GenerateAllLegalMovesForColor(ChessColor color, ChessMoveArray& moveArray);
 
+		// Find the legal move for the given color that packs to the given move, if any.  The caller owns the returned move.
+		ChessMove* UnpackMove(ChessColor color, ChessPackedMove packedMove);
+
 		const ChessMove* GetMove(int i) const;
 		int GetNumMoves() const { return this->chessMoveStack->size(); }
 
 		bool PieceEverMovedFromLocation(const ChessVector& location) const;
 
+		// This is the file of a pawn that made a double step on the last move, which can be captured en-passant, or -1.
+		int GetEnPassantFile() const;
+
+		// Return a Zobrist hash of the position as it would be with the given color to move.  Castling and
+		// en-passant rights are part of the position, but how we got here isn't.  Note that this is calculated
+		// on demand rather than kept up to date as moves are made, because pieces are put on the board while
+		// they're still being constructed.
+		uint64_t GetHashKey(ChessColor whoseTurn) const;
+
 		int GetNumPiecesOnBoard() const;
 
 		// Find all the ways the given color's pieces can move, barring the rules of check.
@@ -54,5 +91,12 @@ namespace ChessEngine
 
 		ChessPiece* boardMatrix[CHESS_BOARD_FILES][CHESS_BOARD_RANKS];
 		ChessMoveArray* chessMoveStack;
+
+		// How many moves on the stack start at each square.  This saves us from scanning the stack for castling rights.
+		// A game restored from a snapshot starts with a count of one wherever a move was made before the snapshot.
+		int moveFromCount[CHESS_BOARD_FILES][CHESS_BOARD_RANKS];
+
+		// The en-passant file as of a restored snapshot, for when there's no move on the stack to tell us.
+		int baseEnPassantFile;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,647 @@
+#include "ChessMonteCarloTree.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+// AVX2 is only used if the CPU running us has it, so the rest of the engine doesn't have to be built for it.
+#if !defined CHESS_NO_AVX2 && (defined _M_X64 || defined __x86_64__)
+#	define CHESS_AVX2_AVAILABLE
+#	if defined _MSC_VER
+#		include <intrin.h>
+#		define CHESS_AVX2_FUNCTION
+#	else
+#		include <immintrin.h>
+#		define CHESS_AVX2_FUNCTION		__attribute__((target("avx2")))
+#	endif
+#endif
+
+using namespace ChessEngine;
+
+// The statistics are read straight out of their atomics, eight at a time.  In tree parallelism, other threads may
+// be updating them as we go, but then the statistics are never exactly up to date anyway.
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Atomic visit counts must be laid out like plain ones.");
+static_assert(sizeof(std::atomic<float>) == sizeof(float), "Atomic scores must be laid out like plain ones.");
+static_assert(sizeof(std::atomic<ChessMonteCarloTree::Proof>) == sizeof(ChessMonteCarloTree::Proof), "Atomic proofs must be laid out like plain ones.");
+
+static bool CanUseAVX2()
+{
+#if defined CHESS_AVX2_AVAILABLE
+#	if defined _MSC_VER
+	// The CPU has to have AVX2, and the OS has to save the YMM registers across context switches.
+	int info[4];
+	::__cpuid(info, 1);
+	bool osSavesYMM = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (::_xgetbv(0) & 6) == 6;
+	::__cpuidex(info, 7, 0);
+	return osSavesYMM && (info[1] & (1 << 5)) != 0;
+#	else
+	return __builtin_cpu_supports("avx2");
+#	endif
+#else
+	return false;
+#endif
+}
+
+ChessMonteCarloTree::ChessMonteCarloTree()
+{
+	this->blockArray = new Block*[CHESS_MCTS_MAX_BLOCKS];
+	this->numBlocks = 0;
+	this->numNodes.store(0);
+	this->rootNode = CHESS_MCTS_NULL_NODE;
+	this->positionArray = nullptr;
+	this->numPositions = 0;
+	this->positionGeneration = 1;
+	this->nodeBudget = CHESS_MCTS_BLOCK_SIZE * CHESS_MCTS_MAX_BLOCKS;
+}
+
+/*virtual*/ ChessMonteCarloTree::~ChessMonteCarloTree()
+{
+	for (uint32_t i = 0; i < this->numBlocks; i++)
+		delete this->blockArray[i];
+
+	delete[] this->blockArray;
+	delete[] this->positionArray;
+}
+
+void ChessMonteCarloTree::Clear()
+{
+	this->numNodes.store(0);
+	this->rootNode = CHESS_MCTS_NULL_NODE;
+
+	// Once the generation comes back around, the oldest slots would look new again, so that's when we really wipe them.
+	if (++this->positionGeneration == 0)
+		this->WipePositionTable();
+}
+
+void ChessMonteCarloTree::WipePositionTable()
+{
+	for (uint32_t i = 0; i < this->numPositions; i++)
+	{
+		this->positionArray[i].tag.store(0, std::memory_order_relaxed);
+		this->positionArray[i].totalScore.store(0.0f, std::memory_order_relaxed);
+		this->positionArray[i].numVisits.store(0, std::memory_order_relaxed);
+	}
+
+	this->positionGeneration = 1;
+}
+
+void ChessMonteCarloTree::SetNodeBudget(uint32_t maxNodes)
+{
+	// Anything less wouldn't leave room to expand even one node.
+	if (maxNodes < CHESS_MCTS_MIN_NODE_BUDGET)
+		maxNodes = CHESS_MCTS_MIN_NODE_BUDGET;
+	if (maxNodes > CHESS_MCTS_BLOCK_SIZE * CHESS_MCTS_MAX_BLOCKS)
+		maxNodes = CHESS_MCTS_BLOCK_SIZE * CHESS_MCTS_MAX_BLOCKS;
+
+	this->nodeBudget = maxNodes;
+	this->FreeBlocksOverBudget();
+}
+
+void ChessMonteCarloTree::FreeBlocksOverBudget()
+{
+	// Blocks beyond the budget will never be used again, once they're empty.
+	uint32_t maxBlocks = (this->nodeBudget + CHESS_MCTS_BLOCK_SIZE - 1) / CHESS_MCTS_BLOCK_SIZE;
+	uint32_t numBlocksInUse = (this->GetNumNodes() + CHESS_MCTS_BLOCK_SIZE - 1) / CHESS_MCTS_BLOCK_SIZE;
+	while (this->numBlocks > maxBlocks && this->numBlocks > numBlocksInUse)
+		delete this->blockArray[--this->numBlocks];
+}
+
+void ChessMonteCarloTree::SetPositionTableSize(uint32_t numPositions)
+{
+	assert((numPositions & (numPositions - 1)) == 0);
+
+	if (numPositions == this->numPositions)
+		return;
+
+	delete[] this->positionArray;
+	this->positionArray = (numPositions > 0) ? new Position[numPositions] : nullptr;
+	this->numPositions = numPositions;
+	this->WipePositionTable();
+
+	// The nodes point into the old table, so they have to go.
+	this->Clear();
+}
+
+void ChessMonteCarloTree::LinkPosition(NodeIndex node, uint64_t hashKey)
+{
+	// The low byte of the key is given over to the generation.  The slot still depends on all of the key.
+	uint64_t tag = (hashKey & ~uint64_t(0xFF)) | this->positionGeneration;
+
+	uint32_t position = CHESS_MCTS_NO_POSITION;
+	for (int i = 0; i < CHESS_MCTS_POSITION_PROBES && position == CHESS_MCTS_NO_POSITION; i++)
+	{
+		uint32_t slot = uint32_t(hashKey + i) & (this->numPositions - 1);
+		Position* entry = &this->positionArray[slot];
+
+		uint64_t slotTag = entry->tag.load(std::memory_order_relaxed);
+		if (slotTag == tag)
+			position = slot;
+		else if ((slotTag & 0xFF) != this->positionGeneration)
+		{
+			// The slot's left over from an earlier tree, so it's ours if nobody beats us to it.  The statistics
+			// are reset after the claim, so anything added by another thread in between is lost, which is harmless.
+			if (entry->tag.compare_exchange_strong(slotTag, tag, std::memory_order_relaxed))
+			{
+				entry->totalScore.store(0.0f, std::memory_order_relaxed);
+				entry->numVisits.store(0, std::memory_order_relaxed);
+				position = slot;
+			}
+			else if (slotTag == tag)
+				position = slot;
+		}
+	}
+
+	this->GetBlock(node)->position[node % CHESS_MCTS_BLOCK_SIZE].store(position, std::memory_order_relaxed);
+}
+
+size_t ChessMonteCarloTree::GetMemoryUsage() const
+{
+	return this->numBlocks * sizeof(Block) + this->numPositions * sizeof(Position);
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::AllocateNodes(int count)
+{
+	MutexLocker locker(this->allocationMutex);
+
+	// A range of nodes never straddles two blocks, so we may have to leave the end of this one unused.
+	uint32_t firstNode = this->numNodes.load(std::memory_order_relaxed);
+	uint32_t blockOffset = firstNode % CHESS_MCTS_BLOCK_SIZE;
+	if (blockOffset > 0 && blockOffset + count > CHESS_MCTS_BLOCK_SIZE)
+		firstNode += CHESS_MCTS_BLOCK_SIZE - blockOffset;
+
+	if (firstNode + count > this->nodeBudget)
+		return CHESS_MCTS_NULL_NODE;
+
+	uint32_t blockIndex = (firstNode + count - 1) / CHESS_MCTS_BLOCK_SIZE;
+
+	while (this->numBlocks <= blockIndex)
+		this->blockArray[this->numBlocks++] = new Block;
+
+	this->numNodes.store(firstNode + count, std::memory_order_relaxed);
+	return firstNode;
+}
+
+void ChessMonteCarloTree::InitializeNode(NodeIndex node, NodeIndex parentNode, ChessPackedMove move)
+{
+	Block* block = this->GetBlock(node);
+	int i = node % CHESS_MCTS_BLOCK_SIZE;
+	block->parent[i] = parentNode;
+	block->firstChild[i].store(CHESS_MCTS_NULL_NODE, std::memory_order_relaxed);
+	block->numChildren[i] = 0;
+	block->move[i] = move;
+	block->numVisits[i].store(0, std::memory_order_relaxed);
+	block->totalScore[i].store(0.0f, std::memory_order_relaxed);
+	block->proof[i].store(Proof::UNKNOWN, std::memory_order_relaxed);
+	block->position[i].store(CHESS_MCTS_UNLINKED_POSITION, std::memory_order_relaxed);
+	block->totalAMAFScore[i].store(0.0f, std::memory_order_relaxed);
+	block->numAMAFVisits[i].store(0, std::memory_order_relaxed);
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::CreateRoot()
+{
+	this->Clear();
+
+	this->rootNode = this->AllocateNodes(1);
+	this->InitializeNode(this->rootNode, CHESS_MCTS_NULL_NODE, CHESS_PACKED_MOVE_NONE);
+
+	return this->rootNode;
+}
+
+bool ChessMonteCarloTree::BeginExpansion(NodeIndex node)
+{
+	NodeIndex expected = CHESS_MCTS_NULL_NODE;
+	return this->GetBlock(node)->firstChild[node % CHESS_MCTS_BLOCK_SIZE].compare_exchange_strong(expected, CHESS_MCTS_EXPANDING, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void ChessMonteCarloTree::CancelExpansion(NodeIndex node)
+{
+	this->GetBlock(node)->firstChild[node % CHESS_MCTS_BLOCK_SIZE].store(CHESS_MCTS_NULL_NODE, std::memory_order_release);
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::AddChildren(NodeIndex parentNode, const ChessPackedMove* moveArray, int numMoves)
+{
+	assert(numMoves > 0 && numMoves <= CHESS_MCTS_MAX_CHILDREN);
+	assert(this->GetNumChildren(parentNode) == 0);
+
+	NodeIndex firstChild = this->AllocateNodes(numMoves);
+	if (firstChild == CHESS_MCTS_NULL_NODE)
+	{
+		this->CancelExpansion(parentNode);
+		return CHESS_MCTS_NULL_NODE;
+	}
+
+	for (int i = 0; i < numMoves; i++)
+		this->InitializeNode(firstChild + i, parentNode, moveArray[i]);
+
+	// Once the first child is published, anyone can see the children, so everything else has to be in place by then.
+	Block* parentBlock = this->GetBlock(parentNode);
+	parentBlock->numChildren[parentNode % CHESS_MCTS_BLOCK_SIZE] = uint16_t(numMoves);
+	parentBlock->firstChild[parentNode % CHESS_MCTS_BLOCK_SIZE].store(firstChild, std::memory_order_release);
+
+	return firstChild;
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::KeepSubtree(NodeIndex node)
+{
+	if (node == this->rootNode)
+		return this->rootNode;
+
+	return this->Rebuild(node, this->nodeBudget);
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::Prune(uint32_t maxNodes)
+{
+	return this->Rebuild(this->rootNode, maxNodes);
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::Rebuild(NodeIndex node, uint32_t maxNodes)
+{
+	// First decide what to keep, a family of children at a time, so that each family stays together.  The most visited
+	// nodes have their children kept first.  When a family doesn't fit, its parent goes back to being a leaf, though it
+	// keeps its own statistics.
+	struct Family
+	{
+		NodeIndex oldFirstNode;
+		NodeIndex newFirstNode;
+		int numNodes;
+	};
+
+	struct Candidate
+	{
+		uint32_t numVisits;
+		NodeIndex node;
+
+		bool operator<(const Candidate& candidate) const { return this->numVisits < candidate.numVisits; }
+	};
+
+	std::vector<Family> familyArray;
+	familyArray.push_back(Family{ node, CHESS_MCTS_NULL_NODE, 1 });
+	uint32_t numKeptNodes = 1;
+
+	std::vector<Candidate> heap;
+	heap.push_back(Candidate{ this->GetNumVisits(node), node });
+	while (heap.size() > 0)
+	{
+		std::pop_heap(heap.begin(), heap.end());
+		Candidate candidate = heap.back();
+		heap.pop_back();
+
+		int numChildren = this->GetNumChildren(candidate.node);
+		if (numChildren == 0 || numKeptNodes + numChildren > maxNodes)
+			continue;
+
+		NodeIndex firstChild = this->GetFirstChild(candidate.node);
+		familyArray.push_back(Family{ firstChild, CHESS_MCTS_NULL_NODE, numChildren });
+		numKeptNodes += numChildren;
+
+		for (int i = 0; i < numChildren; i++)
+		{
+			heap.push_back(Candidate{ this->GetNumVisits(firstChild + i), firstChild + i });
+			std::push_heap(heap.begin(), heap.end());
+		}
+	}
+
+	// Then lay the families out from the start, in the order they're in now.  A family never lands after where it is
+	// now, since it only ever has fewer nodes ahead of it, so we can slide each one down without running over anything
+	// we haven't moved yet.
+	std::sort(familyArray.begin(), familyArray.end(), [](const Family& familyA, const Family& familyB) {
+		return familyA.oldFirstNode < familyB.oldFirstNode;
+	});
+
+	uint32_t nextNode = 0;
+	for (Family& family : familyArray)
+	{
+		uint32_t blockOffset = nextNode % CHESS_MCTS_BLOCK_SIZE;
+		if (blockOffset > 0 && blockOffset + family.numNodes > CHESS_MCTS_BLOCK_SIZE)
+			nextNode += CHESS_MCTS_BLOCK_SIZE - blockOffset;
+
+		family.newFirstNode = nextNode;
+		nextNode += family.numNodes;
+	}
+
+	// This finds the family that a node was in, if we kept it.
+	auto findFamily = [&familyArray](NodeIndex oldNode) -> const Family* {
+		auto iter = std::upper_bound(familyArray.begin(), familyArray.end(), oldNode, [](NodeIndex oldNode, const Family& family) {
+			return oldNode < family.oldFirstNode;
+		});
+		if (iter == familyArray.begin())
+			return nullptr;
+		--iter;
+		return (oldNode < iter->oldFirstNode + iter->numNodes) ? &*iter : nullptr;
+	};
+
+	for (const Family& family : familyArray)
+	{
+		for (int i = 0; i < family.numNodes; i++)
+		{
+			NodeIndex oldNode = family.oldFirstNode + i;
+			NodeIndex newNode = family.newFirstNode + i;
+
+			// The links have to be read before the node is written over.
+			NodeIndex oldParent = this->GetParent(oldNode);
+			NodeIndex oldFirstChild = this->GetFirstChild(oldNode);
+			int numChildren = this->GetNumChildren(oldNode);
+			const Family* childFamily = (oldFirstChild != CHESS_MCTS_NULL_NODE) ? findFamily(oldFirstChild) : nullptr;
+			const Family* parentFamily = (oldNode != node) ? findFamily(oldParent) : nullptr;
+
+			if (newNode != oldNode)
+				this->CopyNode(oldNode, newNode);
+
+			Block* block = this->GetBlock(newNode);
+			int j = newNode % CHESS_MCTS_BLOCK_SIZE;
+			block->parent[j] = parentFamily ? parentFamily->newFirstNode + (oldParent - parentFamily->oldFirstNode) : CHESS_MCTS_NULL_NODE;
+			if (childFamily)
+			{
+				block->numChildren[j] = uint16_t(numChildren);
+				block->firstChild[j].store(childFamily->newFirstNode, std::memory_order_relaxed);
+			}
+			else
+			{
+				block->numChildren[j] = 0;
+				block->firstChild[j].store(CHESS_MCTS_NULL_NODE, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// The blocks we've emptied are kept for the tree to grow back into, so long as they're within the budget.
+	this->numNodes.store(nextNode);
+	this->rootNode = findFamily(node)->newFirstNode;
+	this->FreeBlocksOverBudget();
+
+	return this->rootNode;
+}
+
+void ChessMonteCarloTree::CopyNode(NodeIndex node, NodeIndex toNode)
+{
+	const Block* block = this->GetBlock(node);
+	int i = node % CHESS_MCTS_BLOCK_SIZE;
+	Block* treeBlock = this->GetBlock(toNode);
+	int j = toNode % CHESS_MCTS_BLOCK_SIZE;
+
+	treeBlock->move[j] = block->move[i];
+	treeBlock->numVisits[j].store(block->numVisits[i].load());
+	treeBlock->totalScore[j].store(block->totalScore[i].load());
+	treeBlock->proof[j].store(block->proof[i].load());
+	treeBlock->position[j].store(block->position[i].load());
+	treeBlock->totalAMAFScore[j].store(block->totalAMAFScore[i].load());
+	treeBlock->numAMAFVisits[j].store(block->numAMAFVisits[i].load());
+}
+
+void ChessMonteCarloTree::PropagateProof(NodeIndex node)
+{
+	for (NodeIndex parentNode = this->GetParent(node); parentNode != CHESS_MCTS_NULL_NODE; parentNode = this->GetParent(parentNode))
+	{
+		if (this->GetProof(parentNode) != Proof::UNKNOWN)
+			break;
+
+		// The children are from the point of view of the other side, who will pick the best of them.
+		Proof bestProof = Proof::LOSS;
+		bool allProven = true;
+		NodeIndex firstChild = this->GetFirstChild(parentNode);
+		int numChildren = this->GetNumChildren(parentNode);
+		for (int i = 0; i < numChildren && bestProof != Proof::WIN; i++)
+		{
+			Proof proof = this->GetProof(firstChild + i);
+			if (proof == Proof::UNKNOWN)
+				allProven = false;
+			else if (proof > bestProof)
+				bestProof = proof;
+		}
+
+		if (bestProof != Proof::WIN && !allProven)
+			break;
+
+		switch (bestProof)
+		{
+			case Proof::WIN:
+				this->SetProof(parentNode, Proof::LOSS);
+				break;
+			case Proof::LOSS:
+				this->SetProof(parentNode, Proof::WIN);
+				break;
+			default:
+				this->SetProof(parentNode, Proof::DRAW);
+				break;
+		}
+	}
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::GetBestChild(NodeIndex node) const
+{
+	NodeIndex bestChild = CHESS_MCTS_NULL_NODE;
+	float highestTotalScore = 0.0f;
+	NodeIndex firstChild = this->GetFirstChild(node);
+	int numChildren = this->GetNumChildren(node);
+	for (int i = 0; i < numChildren; i++)
+	{
+		float totalScore = this->GetTotalScore(firstChild + i);
+		if (bestChild == CHESS_MCTS_NULL_NODE || totalScore > highestTotalScore)
+		{
+			bestChild = firstChild + i;
+			highestTotalScore = totalScore;
+		}
+	}
+
+	return bestChild;
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::GetMostVisitedChild(NodeIndex node) const
+{
+	NodeIndex mostVisitedChild = CHESS_MCTS_NULL_NODE;
+	NodeIndex firstChild = this->GetFirstChild(node);
+	int numChildren = this->GetNumChildren(node);
+	for (int i = 0; i < numChildren; i++)
+		if (mostVisitedChild == CHESS_MCTS_NULL_NODE || this->GetNumVisits(firstChild + i) > this->GetNumVisits(mostVisitedChild))
+			mostVisitedChild = firstChild + i;
+
+	return mostVisitedChild;
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::FindChild(NodeIndex node, ChessPackedMove move) const
+{
+	NodeIndex firstChild = this->GetFirstChild(node);
+	int numChildren = this->GetNumChildren(node);
+	for (int i = 0; i < numChildren; i++)
+		if (this->GetMove(firstChild + i) == move)
+			return firstChild + i;
+
+	return CHESS_MCTS_NULL_NODE;
+}
+
+ChessMonteCarloTree::NodeIndex ChessMonteCarloTree::SelectChildByUCB(NodeIndex node, int numChildren, float explorationConstant, float raveEquivalence /*= 0.0f*/) const
+{
+	static bool useAVX2 = CanUseAVX2();
+
+	assert(numChildren > 0 && numChildren <= this->GetNumChildren(node));
+
+	NodeIndex firstChild = this->GetFirstChild(node);
+	const Block* block = this->GetBlock(firstChild);
+	int offset = firstChild % CHESS_MCTS_BLOCK_SIZE;
+	const uint32_t* numVisitsArray = reinterpret_cast<const uint32_t*>(&block->numVisits[offset]);
+	const float* totalScoreArray = reinterpret_cast<const float*>(&block->totalScore[offset]);
+	const Proof* proofArray = reinterpret_cast<const Proof*>(&block->proof[offset]);
+
+	// With a position table or RAVE, we make up the visits and totals that give each child the average we want.
+	uint32_t blendedNumVisitsArray[CHESS_MCTS_MAX_CHILDREN];
+	float blendedTotalScoreArray[CHESS_MCTS_MAX_CHILDREN];
+	if (this->positionArray || raveEquivalence > 0.0f)
+	{
+		for (int j = 0; j < numChildren; j++)
+		{
+			uint32_t numVisits = block->numVisits[offset + j].load(std::memory_order_relaxed);
+			float averageScore = (numVisits > 0) ? block->totalScore[offset + j].load(std::memory_order_relaxed) / float(numVisits) : 0.0f;
+
+			uint32_t position = block->position[offset + j].load(std::memory_order_relaxed);
+			if (position < CHESS_MCTS_NO_POSITION)
+			{
+				uint32_t positionNumVisits = this->positionArray[position].numVisits.load(std::memory_order_relaxed);
+				if (positionNumVisits > 0)
+					averageScore = this->positionArray[position].totalScore.load(std::memory_order_relaxed) / float(positionNumVisits);
+			}
+
+			uint32_t numAMAFVisits = (raveEquivalence > 0.0f) ? block->numAMAFVisits[offset + j].load(std::memory_order_relaxed) : 0;
+			if (numAMAFVisits > 0)
+			{
+				float averageAMAFScore = block->totalAMAFScore[offset + j].load(std::memory_order_relaxed) / float(numAMAFVisits);
+				float beta = ::sqrtf(raveEquivalence / (3.0f * float(numVisits) + raveEquivalence));
+				averageScore = (1.0f - beta) * averageScore + beta * averageAMAFScore;
+				if (numVisits == 0)
+					numVisits = 1;
+			}
+
+			blendedNumVisitsArray[j] = numVisits;
+			blendedTotalScoreArray[j] = float(numVisits) * averageScore;
+		}
+
+		numVisitsArray = blendedNumVisitsArray;
+		totalScoreArray = blendedTotalScoreArray;
+	}
+
+	// This is the same for every child, so we only take the log once.
+	float logParentVisits = ::logf(float(this->GetNumVisits(node)));
+
+	int i = useAVX2 ?
+		SelectByUCB_AVX2(numVisitsArray, totalScoreArray, proofArray, numChildren, logParentVisits, explorationConstant) :
+		SelectByUCB(numVisitsArray, totalScoreArray, proofArray, numChildren, logParentVisits, explorationConstant);
+
+	return firstChild + i;
+}
+
+/*static*/ int ChessMonteCarloTree::SelectByUCB(const uint32_t* numVisitsArray, const float* totalScoreArray, const Proof* proofArray, int count, float logParentVisits, float explorationConstant)
+{
+	int selectedIndex = 0;
+	float highestUCB = -FLT_MAX;
+
+	for (int i = 0; i < count; i++)
+	{
+		// A child we've never been to comes before any other, and so does a move we know wins.
+		if (numVisitsArray[i] == 0 || proofArray[i] == Proof::WIN)
+			return i;
+
+		// There's no point in looking into a move we already know loses.
+		if (proofArray[i] == Proof::LOSS)
+			continue;
+
+		float numVisits = float(numVisitsArray[i]);
+		float exploitationTerm = totalScoreArray[i] / numVisits;
+		float explorationTerm = explorationConstant * ::sqrtf(logParentVisits / numVisits);
+		float ucb = exploitationTerm + explorationTerm;
+		if (ucb > highestUCB)
+		{
+			highestUCB = ucb;
+			selectedIndex = i;
+		}
+	}
+
+	return selectedIndex;
+}
+
+#if defined CHESS_AVX2_AVAILABLE
+
+/*static*/ CHESS_AVX2_FUNCTION int ChessMonteCarloTree::SelectByUCB_AVX2(const uint32_t* numVisitsArray, const float* totalScoreArray, const Proof* proofArray, int count, float logParentVisits, float explorationConstant)
+{
+	// Each lane keeps the best it has seen, and where.  Lanes only take strictly better scores, so like the scalar
+	// version, ties go to whichever child comes first.
+	__m256 bestUCB = _mm256_set1_ps(-FLT_MAX);
+	__m256i bestIndex = _mm256_setzero_si256();
+	__m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i indexStep = _mm256_set1_epi32(8);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256 logParent = _mm256_set1_ps(logParentVisits);
+	const __m256 constant = _mm256_set1_ps(explorationConstant);
+	const __m256 lowest = _mm256_set1_ps(-FLT_MAX);
+	const __m256i loss = _mm256_set1_epi32(int(Proof::LOSS));
+	const __m256i win = _mm256_set1_epi32(int(Proof::WIN));
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i numVisits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&numVisitsArray[i]));
+		__m256i proof = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&proofArray[i])));
+		__m256i takeNow = _mm256_or_si256(_mm256_cmpeq_epi32(numVisits, zero), _mm256_cmpeq_epi32(proof, win));
+		int takeNowMask = _mm256_movemask_ps(_mm256_castsi256_ps(takeNow));
+		if (takeNowMask != 0)
+		{
+			int lane = 0;
+			while ((takeNowMask & (1 << lane)) == 0)
+				lane++;
+			return i + lane;
+		}
+
+		__m256 visits = _mm256_cvtepi32_ps(numVisits);
+		__m256 exploitationTerm = _mm256_div_ps(_mm256_loadu_ps(&totalScoreArray[i]), visits);
+		__m256 explorationTerm = _mm256_mul_ps(constant, _mm256_sqrt_ps(_mm256_div_ps(logParent, visits)));
+		__m256 ucb = _mm256_add_ps(exploitationTerm, explorationTerm);
+
+		// A child known to lose gets the lowest score there is, which is never strictly better than anything.
+		ucb = _mm256_blendv_ps(ucb, lowest, _mm256_castsi256_ps(_mm256_cmpeq_epi32(proof, loss)));
+
+		__m256 better = _mm256_cmp_ps(ucb, bestUCB, _CMP_GT_OQ);
+		bestUCB = _mm256_blendv_ps(bestUCB, ucb, better);
+		bestIndex = _mm256_blendv_epi8(bestIndex, index, _mm256_castps_si256(better));
+		index = _mm256_add_epi32(index, indexStep);
+	}
+
+	float laneUCB[8];
+	int laneIndex[8];
+	_mm256_storeu_ps(laneUCB, bestUCB);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(laneIndex), bestIndex);
+
+	int selectedIndex = 0;
+	float highestUCB = -FLT_MAX;
+	for (int lane = 0; lane < 8; lane++)
+	{
+		if (laneUCB[lane] > highestUCB || (laneUCB[lane] == highestUCB && laneIndex[lane] < selectedIndex))
+		{
+			highestUCB = laneUCB[lane];
+			selectedIndex = laneIndex[lane];
+		}
+	}
+
+	// Whatever didn't make a full set of eight is done the slow way.
+	if (i < count)
+	{
+		int remainderIndex = i + SelectByUCB(&numVisitsArray[i], &totalScoreArray[i], &proofArray[i], count - i, logParentVisits, explorationConstant);
+		if (numVisitsArray[remainderIndex] == 0 || proofArray[remainderIndex] == Proof::WIN)
+			return remainderIndex;
+		if (proofArray[remainderIndex] == Proof::LOSS)
+			return selectedIndex;
+
+		float numVisits = float(numVisitsArray[remainderIndex]);
+		float remainderUCB = totalScoreArray[remainderIndex] / numVisits + explorationConstant * ::sqrtf(logParentVisits / numVisits);
+		if (remainderUCB > highestUCB)
+			selectedIndex = remainderIndex;
+	}
+
+	return selectedIndex;
+}
+
+#else
+
+/*static*/ int ChessMonteCarloTree::SelectByUCB_AVX2(const uint32_t* numVisitsArray, const float* totalScoreArray, const Proof* proofArray, int count, float logParentVisits, float explorationConstant)
+{
+	return SelectByUCB(numVisitsArray, totalScoreArray, proofArray, count, logParentVisits, explorationConstant);
+}
+
+#endif
\ No newline at end of file
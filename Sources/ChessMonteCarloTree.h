@@ -0,0 +1,252 @@
+#pragma once
+
+#include "ChessCommon.h"
+#include "ChessUtils.h"
+#include <atomic>
+
+#define CHESS_MCTS_BLOCK_SIZE		4096
+#define CHESS_MCTS_MAX_BLOCKS		16384
+#define CHESS_MCTS_NULL_NODE		0xFFFFFFFF
+#define CHESS_MCTS_EXPANDING		0xFFFFFFFE
+#define CHESS_MCTS_MAX_CHILDREN		256
+#define CHESS_MCTS_UNLINKED_POSITION	0xFFFFFFFF		// Nobody's looked up the node's position yet.
+#define CHESS_MCTS_NO_POSITION		0xFFFFFFFE		// The table was too full for it.
+#define CHESS_MCTS_POSITION_PROBES	8
+#define CHESS_MCTS_POSITION_TABLE_SIZE	(1 << 20)
+#define CHESS_MCTS_MIN_NODE_BUDGET		(4 * CHESS_MCTS_MAX_CHILDREN)
+
+namespace ChessEngine
+{
+	// This is the tree that MCTS grows, stored in a way that's easy on memory.  Rather than allocate each node
+	// by itself, with all the pointers that come with that, nodes live in big blocks and refer to one another
+	// by 32-bit index.  A node's children are always made together, and they sit side by side, so a node
+	// only needs to know where its first child is and how many there are.  Within a block, each field of
+	// the node gets its own array, so that looking over the statistics of a node's children, which is what
+	// selection does all day, touches as little memory as possible.  The whole tree is thrown away at once,
+	// and its blocks are kept for the next tree.
+	//
+	// Any number of threads may search the tree at once.  Statistics are atomic, and a node is expanded by
+	// whichever thread claims it first.  Nodes are only allocated under a lock, which is rare next to
+	// everything else.  Clearing the tree, or cutting it down to a subtree, is for when nobody's searching.
+	//
+	// Chess is full of transpositions, and the same position reached by different move orders would otherwise
+	// be judged separately.  If given a position table, the tree keeps statistics per position as well as per
+	// node, so that the nodes of a position all learn from one another.  Each node still keeps its own, which
+	// say how often we took that particular move, so the tree behaves as a DAG as far as selection is concerned.
+	// (The nodes of a position don't share children, though.  Following a repetition around in circles, and
+	// finding our way back up from a node, are a lot simpler when every node has the one parent.)
+	class CHESS_ENGINE_API ChessMonteCarloTree
+	{
+	public:
+		typedef uint32_t NodeIndex;
+
+		// What we know for sure about a node, as opposed to what the statistics suggest.  Like the scores, this is
+		// from the point of view of whoever made the move that got us there.  These are in order, worst first.
+		enum class Proof : int8_t
+		{
+			UNKNOWN = 0,
+			LOSS,
+			DRAW,
+			WIN
+		};
+
+		ChessMonteCarloTree();
+		virtual ~ChessMonteCarloTree();
+
+		// Throw away every node, and all position statistics, but keep the memory for next time.
+		void Clear();
+
+		// Nodes aren't allocated beyond this many (counting the few that get left unused at the end of a block), so
+		// when the tree gets this big, expansion stops, unless somebody prunes it.  The default is as big as the tree
+		// can get.  Memory that's no longer needed is freed, but a tree already over the new budget isn't cut down.
+		void SetNodeBudget(uint32_t maxNodes);
+		uint32_t GetNodeBudget() const { return this->nodeBudget; }
+
+		// True if the next expansion might not fit in the budget.
+		bool IsFull() const { return this->GetNumNodes() + 2 * CHESS_MCTS_MAX_CHILDREN > this->nodeBudget; }
+
+		// The table must be a power of two in size, or zero for no table.  Changing the size clears the tree.
+		void SetPositionTableSize(uint32_t numPositions);
+		uint32_t GetPositionTableSize() const { return this->numPositions; }
+
+		// A node only gets its position once somebody gets there and knows what it is.  If the table's too
+		// full for the position, the node just goes without.
+		bool NeedsPosition(NodeIndex node) const { return this->numPositions > 0 && this->GetBlock(node)->position[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed) == CHESS_MCTS_UNLINKED_POSITION; }
+		void LinkPosition(NodeIndex node, uint64_t hashKey);
+
+		// Start over with a tree of just the root, which has no move.
+		NodeIndex CreateRoot();
+
+		// Only one thread gets to expand a node.  If this returns true, the caller must follow up with a
+		// call to AddChildren() or CancelExpansion().  Until then, the node looks like a leaf to everyone else.
+		bool BeginExpansion(NodeIndex node);
+		void CancelExpansion(NodeIndex node);
+
+		// Give the node one child per given move.  It must not have any children already.  This returns the
+		// index of the first child (the others follow it) or null if the tree is as big as it can get.  In
+		// the latter case, an expansion is cancelled.
+		NodeIndex AddChildren(NodeIndex parentNode, const ChessPackedMove* moveArray, int numMoves);
+
+		// Throw away everything that isn't the given node or under it.  The given node becomes the root.  Note that
+		// this renumbers the nodes, and if the tree is over its node budget, it's cut down to it like Prune() does.
+		// The index of the new root is returned.
+		NodeIndex KeepSubtree(NodeIndex node);
+
+		// Cut the tree down to no more than the given number of nodes, by throwing away the children of the least
+		// visited nodes, which become leaves again.  Like KeepSubtree(), this renumbers the nodes.  It's done in
+		// place, so it never takes more memory than the tree already has, and the memory freed up is kept for the
+		// tree to grow back into.  The index of the root is returned.
+		NodeIndex Prune(uint32_t maxNodes);
+
+		NodeIndex GetRoot() const { return this->rootNode; }
+		uint32_t GetNumNodes() const { return this->numNodes.load(std::memory_order_relaxed); }
+		size_t GetMemoryUsage() const;
+
+		NodeIndex GetParent(NodeIndex node) const { return this->GetBlock(node)->parent[node % CHESS_MCTS_BLOCK_SIZE]; }
+		ChessPackedMove GetMove(NodeIndex node) const { return this->GetBlock(node)->move[node % CHESS_MCTS_BLOCK_SIZE]; }
+		uint32_t GetNumVisits(NodeIndex node) const { return this->GetBlock(node)->numVisits[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed); }
+		float GetTotalScore(NodeIndex node) const { return this->GetBlock(node)->totalScore[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed); }
+		uint32_t GetNumAMAFVisits(NodeIndex node) const { return this->GetBlock(node)->numAMAFVisits[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed); }
+		float GetTotalAMAFScore(NodeIndex node) const { return this->GetBlock(node)->totalAMAFScore[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed); }
+		Proof GetProof(NodeIndex node) const { return this->GetBlock(node)->proof[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed); }
+		void SetProof(NodeIndex node, Proof proof) { this->GetBlock(node)->proof[node % CHESS_MCTS_BLOCK_SIZE].store(proof, std::memory_order_relaxed); }
+
+		// Having just proven the given node, see what that proves about its ancestors.  A node is a loss for whoever
+		// moved there if any of its children is a win for the other side.  Once all of its children are proven, it's
+		// whatever the other side's best child is, turned around.
+		void PropagateProof(NodeIndex node);
+
+		// A node that isn't expanded (or is being expanded) has no children.
+		NodeIndex GetFirstChild(NodeIndex node) const
+		{
+			NodeIndex firstChild = this->GetBlock(node)->firstChild[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_acquire);
+			return (firstChild >= CHESS_MCTS_EXPANDING) ? CHESS_MCTS_NULL_NODE : firstChild;
+		}
+
+		int GetNumChildren(NodeIndex node) const
+		{
+			// The count is written before the first child is published, so we must read the latter first.
+			if (this->GetFirstChild(node) == CHESS_MCTS_NULL_NODE)
+				return 0;
+			return this->GetBlock(node)->numChildren[node % CHESS_MCTS_BLOCK_SIZE];
+		}
+
+		// Count a visit and add the given score, for the node and its position.  The number of visits the node
+		// had before this one is returned.
+		uint32_t AddVisit(NodeIndex node, float score)
+		{
+			Block* block = this->GetBlock(node);
+			uint32_t position = block->position[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed);
+			if (position < CHESS_MCTS_NO_POSITION)
+			{
+				this->positionArray[position].totalScore.fetch_add(score, std::memory_order_relaxed);
+				this->positionArray[position].numVisits.fetch_add(1, std::memory_order_relaxed);
+			}
+			block->totalScore[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(score, std::memory_order_relaxed);
+			return block->numVisits[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Add to the score of a visit that was already counted.
+		void AddScore(NodeIndex node, float score)
+		{
+			Block* block = this->GetBlock(node);
+			uint32_t position = block->position[node % CHESS_MCTS_BLOCK_SIZE].load(std::memory_order_relaxed);
+			if (position < CHESS_MCTS_NO_POSITION)
+				this->positionArray[position].totalScore.fetch_add(score, std::memory_order_relaxed);
+			block->totalScore[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(score, std::memory_order_relaxed);
+		}
+
+		// Add the statistics of a node from some other tree.
+		void AddStatistics(NodeIndex node, uint32_t numVisits, float totalScore)
+		{
+			Block* block = this->GetBlock(node);
+			block->totalScore[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(totalScore, std::memory_order_relaxed);
+			block->numVisits[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(numVisits, std::memory_order_relaxed);
+		}
+
+		// Add the results of some games in which the node's move was played, not necessarily first.  These are the
+		// all-moves-as-first (AMAF) statistics of RAVE.
+		void AddAMAFStatistics(NodeIndex node, uint32_t numVisits, float totalScore)
+		{
+			Block* block = this->GetBlock(node);
+			block->totalAMAFScore[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(totalScore, std::memory_order_relaxed);
+			block->numAMAFVisits[node % CHESS_MCTS_BLOCK_SIZE].fetch_add(numVisits, std::memory_order_relaxed);
+		}
+
+		// Of the first given number of children of the given node, return the first that was never visited, or if
+		// they all were, the one with the highest UCB score, which is its average score, plus the given constant
+		// times sqrt(log(parent visits) / visits).  Where the CPU allows, this does eight children at a time.
+		// A child proven to be a win is taken outright, and children proven to be a loss are passed over, unless
+		// there's nothing else.  With a position table, a
+		// child's average score is that of its position, but its visits are still its own.
+		//
+		// If given a RAVE equivalence, k, the average is blended with the AMAF average, which gets a weight of
+		// sqrt(k / (3 * visits + k)).  It counts for everything at first, and less and less as real visits add
+		// up.  A child with AMAF results doesn't have to be visited before it can be judged, so it's treated as
+		// having been visited once, on the strength of those.
+		NodeIndex SelectChildByUCB(NodeIndex node, int numChildren, float explorationConstant, float raveEquivalence = 0.0f) const;
+
+		// Of the children of the given node, which has the highest total score, or the most visits.  Null if it has no children.
+		NodeIndex GetBestChild(NodeIndex node) const;
+		NodeIndex GetMostVisitedChild(NodeIndex node) const;
+		NodeIndex FindChild(NodeIndex node, ChessPackedMove move) const;
+
+	private:
+
+		struct Block
+		{
+			NodeIndex parent[CHESS_MCTS_BLOCK_SIZE];
+			std::atomic<NodeIndex> firstChild[CHESS_MCTS_BLOCK_SIZE];
+			std::atomic<float> totalScore[CHESS_MCTS_BLOCK_SIZE];
+			std::atomic<uint32_t> numVisits[CHESS_MCTS_BLOCK_SIZE];
+			ChessPackedMove move[CHESS_MCTS_BLOCK_SIZE];
+			uint16_t numChildren[CHESS_MCTS_BLOCK_SIZE];
+			std::atomic<Proof> proof[CHESS_MCTS_BLOCK_SIZE];
+			std::atomic<uint32_t> position[CHESS_MCTS_BLOCK_SIZE];		// An index into the position table.
+			std::atomic<float> totalAMAFScore[CHESS_MCTS_BLOCK_SIZE];
+			std::atomic<uint32_t> numAMAFVisits[CHESS_MCTS_BLOCK_SIZE];
+		};
+
+		// A slot in the position table is claimed by whoever first writes a tag into it.  The tag is the position's
+		// hash key with the table's generation in the low byte, so a slot from before the last Clear() is as good as
+		// free, and clearing doesn't have to touch the table.  Zero means the slot has never been used.
+		struct Position
+		{
+			std::atomic<uint64_t> tag;
+			std::atomic<float> totalScore;
+			std::atomic<uint32_t> numVisits;
+		};
+
+		Block* GetBlock(NodeIndex node) const { return this->blockArray[node / CHESS_MCTS_BLOCK_SIZE]; }
+
+		// These return the offset of the chosen child into the given arrays.
+		static int SelectByUCB(const uint32_t* numVisitsArray, const float* totalScoreArray, const Proof* proofArray, int count, float logParentVisits, float explorationConstant);
+		static int SelectByUCB_AVX2(const uint32_t* numVisitsArray, const float* totalScoreArray, const Proof* proofArray, int count, float logParentVisits, float explorationConstant);
+
+		// Keep the given node, as the root, and as much of what's under it as fits in the given number of nodes.  This is
+		// done in place, by sliding what's kept down to the start of the tree, so it needs no more memory than the tree
+		// already has, other than a little bookkeeping per family of children kept.
+		NodeIndex Rebuild(NodeIndex node, uint32_t maxNodes);
+
+		void FreeBlocksOverBudget();
+		void WipePositionTable();
+
+		// Copy everything but the links to parent and children.
+		void CopyNode(NodeIndex node, NodeIndex toNode);
+
+		// Make room for the given number of nodes, all in the same block, and return the index of the first.
+		NodeIndex AllocateNodes(int count);
+		void InitializeNode(NodeIndex node, NodeIndex parentNode, ChessPackedMove move);
+
+		// This is a fixed array, rather than a vector, so that it never moves out from under anyone.
+		Block** blockArray;
+		uint32_t numBlocks;
+		std::atomic<uint32_t> numNodes;
+		NodeIndex rootNode;
+		Mutex allocationMutex;
+		Position* positionArray;
+		uint32_t numPositions;
+		uint8_t positionGeneration;
+		uint32_t nodeBudget;
+	};
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "ChessGame.h"
 #include "ChessPiece.h"
 #include <sstream>
+#include <assert.h>
 
 using namespace ChessEngine;
 
@@ -25,6 +26,27 @@ ChessMove::ChessMove()
 	return 0;
 }
 
+// Bits 0-5 hold the source square, bits 6-11 the destination square, and bits 12-14 any promotion.
+// Since a move never begins and ends on the same square, zero is never a valid packed move.
+/*virtual*/ ChessPackedMove ChessMove::Pack() const
+{
+	int sourceSquare = this->sourceLocation.rank * CHESS_BOARD_FILES + this->sourceLocation.file;
+	int destinationSquare = this->destinationLocation.rank * CHESS_BOARD_FILES + this->destinationLocation.file;
+	return ChessPackedMove(sourceSquare | (destinationSquare << 6));
+}
+
+/*static*/ ChessVector ChessMove::UnpackSourceLocation(ChessPackedMove packedMove)
+{
+	int sourceSquare = packedMove & 0x3F;
+	return ChessVector(sourceSquare % CHESS_BOARD_FILES, sourceSquare / CHESS_BOARD_FILES);
+}
+
+/*static*/ ChessVector ChessMove::UnpackDestinationLocation(ChessPackedMove packedMove)
+{
+	int destinationSquare = (packedMove >> 6) & 0x3F;
+	return ChessVector(destinationSquare % CHESS_BOARD_FILES, destinationSquare / CHESS_BOARD_FILES);
+}
+
 /*virtual*/ bool ChessMove::WriteToStream(std::ostream& stream) const
 {
 	this->WriteInt(stream, this->sourceLocation.file);
@@ -314,6 +336,7 @@ Promotion::Promotion()
 {
 	this->newPiece = nullptr;
 	this->oldPiece = nullptr;
+	this->promotedPieceCode = Code::EMPTY;
 
 	this->cachedDesc[0] = '\0';
 }
@@ -362,6 +385,7 @@ Promotion::Promotion()
 void Promotion::SetPromotedPiece(ChessPiece* piece)
 {
 	this->newPiece = piece;
+	this->promotedPieceCode = piece->GetCode();
 	std::stringstream stream;
 	stream << "Promote pawn to " << this->newPiece->GetName() << " at " << this->destinationLocation.GetLocationString();
 	::strcpy_s(this->cachedDesc, sizeof(this->cachedDesc), stream.str().c_str());
@@ -377,6 +401,21 @@ void Promotion::SetPromotedPiece(ChessPiece* piece)
 	return 3;
 }
 
+/*virtual*/ ChessPackedMove Promotion::Pack() const
+{
+	int promotion = 0;
+	switch (this->promotedPieceCode)
+	{
+		case Code::KNIGHT:	promotion = 1;	break;
+		case Code::BISHOP:	promotion = 2;	break;
+		case Code::ROOK:	promotion = 3;	break;
+		case Code::QUEEN:	promotion = 4;	break;
+		default:			assert(false);	break;		// Anything else would unpack as no promotion at all.
+	}
+
+	return ChessPackedMove(ChessMove::Pack() | (promotion << 12));
+}
+
 /*virtual*/ bool Promotion::WriteToStream(std::ostream& stream) const
 {
 	if (!ChessMove::WriteToStream(stream))
@@ -403,6 +442,9 @@ void Promotion::SetPromotedPiece(ChessPiece* piece)
 	if (!this->ReadPiece(stream, this->oldPiece))
 		return false;
 
+	if (this->newPiece)
+		this->promotedPieceCode = this->newPiece->GetCode();
+
 	this->ReadString(stream, this->cachedDesc, sizeof(this->cachedDesc));
 	return true;
 }
@@ -23,6 +23,11 @@ namespace ChessEngine
 		virtual std::string GetDescription() const;
 		virtual int GetSortKey() const;
 
+		virtual ChessPackedMove Pack() const;
+
+		static ChessVector UnpackSourceLocation(ChessPackedMove packedMove);
+		static ChessVector UnpackDestinationLocation(ChessPackedMove packedMove);
+
 		virtual bool WriteToStream(std::ostream& stream) const override;
 		virtual bool ReadFromStream(std::istream& stream) override;
 
@@ -106,6 +111,8 @@ namespace ChessEngine
 
 		virtual Code GetCode() const override;
 
+		virtual ChessPackedMove Pack() const override;
+
 		void SetPromotedPiece(ChessPiece* piece);
 
 	protected:
@@ -113,6 +120,9 @@ namespace ChessEngine
 		ChessPiece* newPiece;
 		ChessPiece* oldPiece;
 
+		// Remembered separately from the new piece, because that piece lives on the board while the move is done.
+		Code promotedPieceCode;
+
 		char cachedDesc[128];
 	};
 
@@ -196,10 +196,10 @@ Pawn::Pawn(ChessGame* game, const ChessVector& location, ChessColor color) : Che
 		else
 		{
 			piece = this->game->GetSquareOccupant(this->location + sideVector[i]);
-			if (piece && piece->color == opponentColor && dynamic_cast<Pawn*>(piece) && this->game->GetNumMoves() > 0)
+			if (piece && piece->color == opponentColor && dynamic_cast<Pawn*>(piece))
 			{
-				const Travel* travel = dynamic_cast<const Travel*>(this->game->GetMove(this->game->GetNumMoves() - 1));
-				if (travel && travel->sourceLocation == this->location + forwardDirection * 2 + sideVector[i] && travel->destinationLocation == this->location + sideVector[i])
+				// The pawn beside us must be the one that just made a double step, which puts us three ranks up from our start.
+				if (this->game->GetEnPassantFile() == piece->location.file && this->location.rank == initialRank + forwardDirection.rank * 3)
 				{
 					// Thankfully, I don't think it's possible to en-passant & promote at the same time.
 					EnPassant* enPassant = new EnPassant();
@@ -0,0 +1,601 @@
+#include "ChessPlayout.h"
+#include "ChessGame.h"
+#include "ChessPiece.h"
+#include "ChessMove.h"
+
+using namespace ChessEngine;
+
+static const int knightDirectionArray[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+static const int bishopDirectionArray[4][2] = { {1, 1}, {1, -1}, {-1, -1}, {-1, 1} };
+static const int rookDirectionArray[4][2] = { {1, 0}, {0, -1}, {-1, 0}, {0, 1} };
+static const int queenDirectionArray[8][2] = { {1, 1}, {1, -1}, {-1, -1}, {-1, 1}, {1, 0}, {0, -1}, {-1, 0}, {0, 1} };
+
+//---------------------------------------- PlayoutZobristKeys ----------------------------------------
+
+// These are the playout board's own, since it keeps castling rights rather than a history of who moved where.
+// They don't hash a position the same way ChessGame::GetHashKey() does, and they don't need to.
+struct PlayoutZobristKeys
+{
+	PlayoutZobristKeys()
+	{
+		uint64_t seed = 0xD1B54A32D192ED03ULL;
+
+		for (int i = 0; i < 2 * ChessPlayoutBoard::KING + 1; i++)
+			for (int j = 0; j < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; j++)
+				this->pieceKey[i][j] = Next(seed);
+
+		for (int i = 0; i < 16; i++)
+			this->castlingKey[i] = Next(seed);
+
+		for (int i = 0; i < CHESS_BOARD_FILES; i++)
+			this->enPassantKey[i] = Next(seed);
+
+		this->whiteToMoveKey = Next(seed);
+	}
+
+	// This is the splitmix64 generator.
+	static uint64_t Next(uint64_t& seed)
+	{
+		uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t pieceKey[2 * ChessPlayoutBoard::KING + 1][CHESS_BOARD_FILES * CHESS_BOARD_RANKS];		// Indexed by piece plus KING.
+	uint64_t castlingKey[16];
+	uint64_t enPassantKey[CHESS_BOARD_FILES];
+	uint64_t whiteToMoveKey;
+};
+
+static PlayoutZobristKeys playoutZobristKeys;
+
+//---------------------------------------- ChessPlayoutBoard ----------------------------------------
+
+void ChessPlayoutBoard::SetFromGame(const ChessGame* game, ChessColor whoseTurn)
+{
+	this->whoseTurn = whoseTurn;
+	this->kingSquare[0] = -1;
+	this->kingSquare[1] = -1;
+	this->enPassantFile = -1;
+	this->castlingRights = 0;
+	this->numPieces = 0;
+
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+	{
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+		{
+			int square = MakeSquare(i, j);
+			const ChessPiece* piece = game->GetSquareOccupant(ChessVector(i, j));
+			if (!piece)
+			{
+				this->squareArray[square] = EMPTY;
+				continue;
+			}
+
+			int8_t pieceType = int8_t(int(piece->GetCode()) - int(ChessObject::Code::PAWN) + PAWN);
+			this->squareArray[square] = (piece->color == ChessColor::White) ? pieceType : -pieceType;
+			this->numPieces++;
+
+			if (pieceType == KING)
+				this->kingSquare[int(piece->color)] = int8_t(square);
+		}
+	}
+
+	// Castling is possible so long as neither the king nor the rook ever left home.
+	struct CastlingHome
+	{
+		int rank;
+		int rookFile;
+		int8_t king;
+		int8_t rook;
+		uint8_t right;
+	};
+
+	static const CastlingHome castlingHomeArray[] =
+	{
+		{ 0, 7, KING, ROOK, WHITE_KING_SIDE },
+		{ 0, 0, KING, ROOK, WHITE_QUEEN_SIDE },
+		{ 7, 7, -KING, -ROOK, BLACK_KING_SIDE },
+		{ 7, 0, -KING, -ROOK, BLACK_QUEEN_SIDE }
+	};
+
+	for (const CastlingHome& home : castlingHomeArray)
+	{
+		ChessVector kingLocation(4, home.rank);
+		ChessVector rookLocation(home.rookFile, home.rank);
+		if (this->squareArray[MakeSquare(4, home.rank)] == home.king && !game->PieceEverMovedFromLocation(kingLocation) &&
+			this->squareArray[MakeSquare(home.rookFile, home.rank)] == home.rook && !game->PieceEverMovedFromLocation(rookLocation))
+		{
+			this->castlingRights |= home.right;
+		}
+	}
+
+	this->enPassantFile = int8_t(game->GetEnPassantFile());
+}
+
+/*static*/ uint32_t ChessPlayoutBoard::NextRandom(uint64_t& randomState)
+{
+	randomState ^= randomState >> 12;
+	randomState ^= randomState << 25;
+	randomState ^= randomState >> 27;
+	return uint32_t((randomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+void ChessPlayoutBoard::GetSnapshot(ChessGameSnapshot& snapshot) const
+{
+	for (int i = 0; i < CHESS_BOARD_FILES; i++)
+		for (int j = 0; j < CHESS_BOARD_RANKS; j++)
+			snapshot.squareArray[i][j] = this->squareArray[MakeSquare(i, j)];
+
+	// We don't know who moved where, only what castling is still possible.  Where a right has been lost,
+	// it's enough to say that the rook left home.
+	static const struct { uint8_t right; int square; } rookHomeArray[] =
+	{
+		{ WHITE_KING_SIDE, MakeSquare(7, 0) },
+		{ WHITE_QUEEN_SIDE, MakeSquare(0, 0) },
+		{ BLACK_KING_SIDE, MakeSquare(7, 7) },
+		{ BLACK_QUEEN_SIDE, MakeSquare(0, 7) }
+	};
+
+	snapshot.everMovedMask = 0;
+	for (const auto& rookHome : rookHomeArray)
+		if ((this->castlingRights & rookHome.right) == 0)
+			snapshot.everMovedMask |= uint64_t(1) << rookHome.square;
+
+	snapshot.enPassantFile = this->enPassantFile;
+	snapshot.numHistoryHashes = 0;
+}
+
+uint64_t ChessPlayoutBoard::GetHashKey() const
+{
+	uint64_t hashKey = 0;
+
+	for (int square = 0; square < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; square++)
+		if (this->squareArray[square] != EMPTY)
+			hashKey ^= playoutZobristKeys.pieceKey[this->squareArray[square] + KING][square];
+
+	hashKey ^= playoutZobristKeys.castlingKey[this->castlingRights];
+
+	if (this->enPassantFile >= 0)
+		hashKey ^= playoutZobristKeys.enPassantKey[this->enPassantFile];
+
+	if (this->whoseTurn == ChessColor::White)
+		hashKey ^= playoutZobristKeys.whiteToMoveKey;
+
+	return hashKey;
+}
+
+double ChessPlayoutBoard::PlayRandomGame(ChessColor favoredColor, int maxMoves, uint64_t& randomState, ChessPlayoutMoveSet* moveSet /*= nullptr*/)
+{
+	// Running out of moves is called a draw, which is what the result is left at.
+	double gameResult = 0.0;
+	this->PlayRandomMoves(favoredColor, maxMoves, randomState, gameResult, moveSet);
+	return gameResult;
+}
+
+bool ChessPlayoutBoard::PlayRandomMoves(ChessColor favoredColor, int maxMoves, uint64_t& randomState, double& gameResult, ChessPlayoutMoveSet* moveSet /*= nullptr*/)
+{
+	ChessPlayoutMove moveArray[CHESS_PLAYOUT_MAX_MOVES];
+
+	for (int numMovesMade = 0; maxMoves <= 0 || numMovesMade < maxMoves; numMovesMade++)
+	{
+		// Two kings can't do anything to each other.
+		if (this->numPieces <= 2)
+		{
+			gameResult = 0.0;
+			return true;
+		}
+
+		ChessColor moverColor = this->whoseTurn;
+		ChessColor opponentColor = (moverColor == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+
+		// Rather than weed out all the illegal moves up front, we pick moves at random until we find one that
+		// doesn't leave our king in check.  Most moves are legal, so we usually only have to check the one.
+		int numMoves = this->GeneratePseudoLegalMoves(moveArray);
+		bool moved = false;
+		while (numMoves > 0)
+		{
+			int i = int(NextRandom(randomState) % uint32_t(numMoves));
+
+			ChessPlayoutBoard nextBoard = *this;
+			nextBoard.MakeMove(moveArray[i]);
+			int ourKingSquare = nextBoard.kingSquare[int(moverColor)];
+			if (ourKingSquare < 0 || !nextBoard.IsSquareAttacked(ourKingSquare, opponentColor))
+			{
+				if (moveSet)
+					moveSet->Add(moverColor, moveArray[i].Pack());
+				*this = nextBoard;
+				moved = true;
+				break;
+			}
+
+			moveArray[i] = moveArray[--numMoves];
+		}
+
+		// Have we reached the end of the game?
+		if (!moved)
+		{
+			if (this->IsInCheck(moverColor))
+				gameResult = (moverColor == favoredColor) ? -1.0 : 1.0;
+			else
+				gameResult = 0.0;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int ChessPlayoutBoard::Evaluate(ChessColor favoredColor) const
+{
+	// These are the same as what the pieces return from ChessPiece::GetScore().
+	static const int pieceScoreArray[] = { 0, 10, 30, 30, 50, 90, 900 };
+
+	int totalScore = 0;
+	for (int square = 0; square < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; square++)
+	{
+		int8_t piece = this->squareArray[square];
+		if (piece == EMPTY)
+			continue;
+
+		int score = pieceScoreArray[(piece > 0) ? piece : -piece];
+		score += ChessVector(GetFile(square), GetRank(square)).ShortestDistanceToBoardEdge();
+
+		ChessColor pieceColor = (piece > 0) ? ChessColor::White : ChessColor::Black;
+		if (pieceColor == favoredColor)
+			totalScore += score;
+		else
+			totalScore -= score;
+	}
+
+	return totalScore;
+}
+
+void ChessPlayoutBoard::AddMove(ChessPlayoutMove* moveArray, int& numMoves, int sourceSquare, int destinationSquare, uint8_t flags, int8_t promotedPiece /*= EMPTY*/) const
+{
+	assert(numMoves < CHESS_PLAYOUT_MAX_MOVES);
+	if (numMoves >= CHESS_PLAYOUT_MAX_MOVES)
+		return;
+
+	ChessPlayoutMove& move = moveArray[numMoves++];
+	move.sourceSquare = uint8_t(sourceSquare);
+	move.destinationSquare = uint8_t(destinationSquare);
+	move.promotedPiece = promotedPiece;
+	move.flags = flags;
+}
+
+void ChessPlayoutBoard::AddPawnMoves(ChessPlayoutMove* moveArray, int& numMoves, int sourceSquare, int destinationSquare, uint8_t flags) const
+{
+	// Like the pieces of the ChessGame, we offer every promotion, not just the queen.
+	int rank = GetRank(destinationSquare);
+	if (rank == 0 || rank == CHESS_BOARD_RANKS - 1)
+	{
+		for (int8_t promotedPiece = KNIGHT; promotedPiece <= QUEEN; promotedPiece++)
+			this->AddMove(moveArray, numMoves, sourceSquare, destinationSquare, flags, promotedPiece);
+	}
+	else
+	{
+		this->AddMove(moveArray, numMoves, sourceSquare, destinationSquare, flags);
+	}
+}
+
+void ChessPlayoutBoard::AddSlidingMoves(ChessPlayoutMove* moveArray, int& numMoves, int sourceSquare, const int(*directionArray)[2], int numDirections, int maxLength) const
+{
+	int sign = (this->whoseTurn == ChessColor::White) ? 1 : -1;
+	int file = GetFile(sourceSquare);
+	int rank = GetRank(sourceSquare);
+
+	for (int i = 0; i < numDirections; i++)
+	{
+		int rayFile = file;
+		int rayRank = rank;
+		for (int j = 0; j < maxLength; j++)
+		{
+			rayFile += directionArray[i][0];
+			rayRank += directionArray[i][1];
+			if (rayFile < 0 || rayFile >= CHESS_BOARD_FILES || rayRank < 0 || rayRank >= CHESS_BOARD_RANKS)
+				break;
+
+			int raySquare = MakeSquare(rayFile, rayRank);
+			int8_t occupant = this->squareArray[raySquare];
+			if (occupant == EMPTY)
+			{
+				this->AddMove(moveArray, numMoves, sourceSquare, raySquare, 0);
+				continue;
+			}
+
+			if (occupant * sign < 0)
+				this->AddMove(moveArray, numMoves, sourceSquare, raySquare, ChessPlayoutMove::CAPTURE);
+
+			break;
+		}
+	}
+}
+
+int ChessPlayoutBoard::GeneratePseudoLegalMoves(ChessPlayoutMove* moveArray) const
+{
+	int numMoves = 0;
+	int sign = (this->whoseTurn == ChessColor::White) ? 1 : -1;
+	int forward = sign;
+	int initialRank = (this->whoseTurn == ChessColor::White) ? 1 : 6;
+	int enPassantRank = (this->whoseTurn == ChessColor::White) ? 4 : 3;
+	ChessColor opponentColor = (this->whoseTurn == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+
+	for (int square = 0; square < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; square++)
+	{
+		int8_t occupant = this->squareArray[square] * sign;
+		if (occupant <= 0)
+			continue;
+
+		int file = GetFile(square);
+		int rank = GetRank(square);
+
+		switch (occupant)
+		{
+			case PAWN:
+			{
+				int forwardRank = rank + forward;
+				if (forwardRank < 0 || forwardRank >= CHESS_BOARD_RANKS)
+					break;
+
+				int forwardSquare = MakeSquare(file, forwardRank);
+				if (this->squareArray[forwardSquare] == EMPTY)
+				{
+					this->AddPawnMoves(moveArray, numMoves, square, forwardSquare, 0);
+
+					if (rank == initialRank)
+					{
+						int doubleSquare = MakeSquare(file, rank + 2 * forward);
+						if (this->squareArray[doubleSquare] == EMPTY)
+							this->AddMove(moveArray, numMoves, square, doubleSquare, ChessPlayoutMove::DOUBLE_STEP);
+					}
+				}
+
+				for (int side = -1; side <= 1; side += 2)
+				{
+					int sideFile = file + side;
+					if (sideFile < 0 || sideFile >= CHESS_BOARD_FILES)
+						continue;
+
+					int captureSquare = MakeSquare(sideFile, forwardRank);
+					if (this->squareArray[captureSquare] * sign < 0)
+						this->AddPawnMoves(moveArray, numMoves, square, captureSquare, ChessPlayoutMove::CAPTURE);
+					else if (this->squareArray[captureSquare] == EMPTY && rank == enPassantRank && sideFile == this->enPassantFile)
+						this->AddMove(moveArray, numMoves, square, captureSquare, ChessPlayoutMove::CAPTURE | ChessPlayoutMove::EN_PASSANT);
+				}
+
+				break;
+			}
+			case KNIGHT:
+			{
+				this->AddSlidingMoves(moveArray, numMoves, square, knightDirectionArray, 8, 1);
+				break;
+			}
+			case BISHOP:
+			{
+				this->AddSlidingMoves(moveArray, numMoves, square, bishopDirectionArray, 4, INT_MAX);
+				break;
+			}
+			case ROOK:
+			{
+				this->AddSlidingMoves(moveArray, numMoves, square, rookDirectionArray, 4, INT_MAX);
+				break;
+			}
+			case QUEEN:
+			{
+				this->AddSlidingMoves(moveArray, numMoves, square, queenDirectionArray, 8, INT_MAX);
+				break;
+			}
+			case KING:
+			{
+				this->AddSlidingMoves(moveArray, numMoves, square, queenDirectionArray, 8, 1);
+
+				// We can't castle out of, through or into check.  Into is caught later along with every
+				// other move, but the other two we have to check here.
+				uint8_t kingSideRight = (this->whoseTurn == ChessColor::White) ? WHITE_KING_SIDE : BLACK_KING_SIDE;
+				uint8_t queenSideRight = (this->whoseTurn == ChessColor::White) ? WHITE_QUEEN_SIDE : BLACK_QUEEN_SIDE;
+				if ((this->castlingRights & (kingSideRight | queenSideRight)) == 0 || this->IsSquareAttacked(square, opponentColor))
+					break;
+
+				if ((this->castlingRights & kingSideRight) != 0 &&
+					this->squareArray[square + 1] == EMPTY &&
+					this->squareArray[square + 2] == EMPTY &&
+					!this->IsSquareAttacked(square + 1, opponentColor))
+				{
+					this->AddMove(moveArray, numMoves, square, square + 2, ChessPlayoutMove::CASTLE);
+				}
+
+				if ((this->castlingRights & queenSideRight) != 0 &&
+					this->squareArray[square - 1] == EMPTY &&
+					this->squareArray[square - 2] == EMPTY &&
+					this->squareArray[square - 3] == EMPTY &&
+					!this->IsSquareAttacked(square - 1, opponentColor))
+				{
+					this->AddMove(moveArray, numMoves, square, square - 2, ChessPlayoutMove::CASTLE);
+				}
+
+				break;
+			}
+		}
+	}
+
+	return numMoves;
+}
+
+int ChessPlayoutBoard::GenerateLegalMoves(ChessPlayoutMove* moveArray) const
+{
+	ChessColor moverColor = this->whoseTurn;
+	ChessColor opponentColor = (moverColor == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+
+	int numMoves = this->GeneratePseudoLegalMoves(moveArray);
+	int numLegalMoves = 0;
+	for (int i = 0; i < numMoves; i++)
+	{
+		ChessPlayoutBoard nextBoard = *this;
+		nextBoard.MakeMove(moveArray[i]);
+		int ourKingSquare = nextBoard.kingSquare[int(moverColor)];
+		if (ourKingSquare < 0 || !nextBoard.IsSquareAttacked(ourKingSquare, opponentColor))
+			moveArray[numLegalMoves++] = moveArray[i];
+	}
+
+	return numLegalMoves;
+}
+
+int ChessPlayoutBoard::GetMovePriority(const ChessPlayoutMove& move) const
+{
+	int priority = 0;
+
+	if ((move.flags & ChessPlayoutMove::CAPTURE) != 0)
+	{
+		int8_t attacker = this->squareArray[move.sourceSquare];
+		int8_t victim = ((move.flags & ChessPlayoutMove::EN_PASSANT) != 0) ? int8_t(PAWN) : this->squareArray[move.destinationSquare];
+		priority += 16 * ((victim > 0) ? victim : -victim) - ((attacker > 0) ? attacker : -attacker) + 16;
+	}
+
+	if (move.promotedPiece != EMPTY)
+		priority += move.promotedPiece;
+
+	return priority;
+}
+
+ChessPlayoutMove ChessPlayoutBoard::UnpackMove(ChessPackedMove packedMove) const
+{
+	ChessPlayoutMove move;
+	move.sourceSquare = uint8_t(packedMove & 0x3F);
+	move.destinationSquare = uint8_t((packedMove >> 6) & 0x3F);
+	int promotion = (packedMove >> 12) & 0x7;
+	move.promotedPiece = (promotion != 0) ? int8_t(promotion + 1) : int8_t(EMPTY);
+	move.flags = 0;
+
+	int8_t movingPiece = this->squareArray[move.sourceSquare];
+	int pieceType = (movingPiece > 0) ? movingPiece : -movingPiece;
+	int fileDelta = GetFile(move.destinationSquare) - GetFile(move.sourceSquare);
+	int rankDelta = GetRank(move.destinationSquare) - GetRank(move.sourceSquare);
+
+	if (this->squareArray[move.destinationSquare] != EMPTY)
+		move.flags |= ChessPlayoutMove::CAPTURE;
+	else if (pieceType == PAWN && fileDelta != 0)
+		move.flags |= ChessPlayoutMove::CAPTURE | ChessPlayoutMove::EN_PASSANT;
+
+	if (pieceType == PAWN && (rankDelta == 2 || rankDelta == -2))
+		move.flags |= ChessPlayoutMove::DOUBLE_STEP;
+	else if (pieceType == KING && (fileDelta == 2 || fileDelta == -2))
+		move.flags |= ChessPlayoutMove::CASTLE;
+
+	return move;
+}
+
+void ChessPlayoutBoard::MakeMove(const ChessPlayoutMove& move)
+{
+	int8_t movingPiece = this->squareArray[move.sourceSquare];
+	int sign = (movingPiece > 0) ? 1 : -1;
+
+	if ((move.flags & ChessPlayoutMove::EN_PASSANT) != 0)
+	{
+		int capturedSquare = MakeSquare(GetFile(move.destinationSquare), GetRank(move.sourceSquare));
+		this->squareArray[capturedSquare] = EMPTY;
+		this->numPieces--;
+	}
+	else if ((move.flags & ChessPlayoutMove::CAPTURE) != 0)
+	{
+		this->numPieces--;
+	}
+
+	this->squareArray[move.destinationSquare] = (move.promotedPiece != EMPTY) ? int8_t(move.promotedPiece * sign) : movingPiece;
+	this->squareArray[move.sourceSquare] = EMPTY;
+
+	if ((move.flags & ChessPlayoutMove::CASTLE) != 0)
+	{
+		int rank = GetRank(move.sourceSquare);
+		bool kingSide = move.destinationSquare > move.sourceSquare;
+		int rookSourceSquare = MakeSquare(kingSide ? 7 : 0, rank);
+		int rookDestinationSquare = kingSide ? move.sourceSquare + 1 : move.sourceSquare - 1;
+		this->squareArray[rookDestinationSquare] = this->squareArray[rookSourceSquare];
+		this->squareArray[rookSourceSquare] = EMPTY;
+	}
+
+	if (movingPiece * sign == KING)
+		this->kingSquare[(sign > 0) ? int(ChessColor::White) : int(ChessColor::Black)] = int8_t(move.destinationSquare);
+
+	// Anything leaving or landing on a home square of a king or rook spoils castling with it.
+	static const struct { int8_t square; uint8_t rights; } castlingSquareArray[] =
+	{
+		{ 4, WHITE_KING_SIDE | WHITE_QUEEN_SIDE },
+		{ 7, WHITE_KING_SIDE },
+		{ 0, WHITE_QUEEN_SIDE },
+		{ 60, BLACK_KING_SIDE | BLACK_QUEEN_SIDE },
+		{ 63, BLACK_KING_SIDE },
+		{ 56, BLACK_QUEEN_SIDE }
+	};
+
+	if (this->castlingRights != 0)
+		for (const auto& castlingSquare : castlingSquareArray)
+			if (move.sourceSquare == castlingSquare.square || move.destinationSquare == castlingSquare.square)
+				this->castlingRights &= ~castlingSquare.rights;
+
+	this->enPassantFile = ((move.flags & ChessPlayoutMove::DOUBLE_STEP) != 0) ? int8_t(GetFile(move.sourceSquare)) : -1;
+	this->whoseTurn = (this->whoseTurn == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+}
+
+bool ChessPlayoutBoard::IsSquareAttacked(int square, ChessColor attackerColor) const
+{
+	int sign = (attackerColor == ChessColor::White) ? 1 : -1;
+	int file = GetFile(square);
+	int rank = GetRank(square);
+
+	// Pawns attack from one rank behind, as seen from their side.
+	int pawnRank = rank - sign;
+	if (pawnRank >= 0 && pawnRank < CHESS_BOARD_RANKS)
+	{
+		if (file > 0 && this->squareArray[MakeSquare(file - 1, pawnRank)] == PAWN * sign)
+			return true;
+		if (file < CHESS_BOARD_FILES - 1 && this->squareArray[MakeSquare(file + 1, pawnRank)] == PAWN * sign)
+			return true;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		int knightFile = file + knightDirectionArray[i][0];
+		int knightRank = rank + knightDirectionArray[i][1];
+		if (knightFile >= 0 && knightFile < CHESS_BOARD_FILES && knightRank >= 0 && knightRank < CHESS_BOARD_RANKS)
+			if (this->squareArray[MakeSquare(knightFile, knightRank)] == KNIGHT * sign)
+				return true;
+	}
+
+	// The first four queen directions are diagonal, the last four straight.
+	for (int i = 0; i < 8; i++)
+	{
+		int8_t slider = (i < 4) ? BISHOP : ROOK;
+		int rayFile = file;
+		int rayRank = rank;
+		for (int j = 1; ; j++)
+		{
+			rayFile += queenDirectionArray[i][0];
+			rayRank += queenDirectionArray[i][1];
+			if (rayFile < 0 || rayFile >= CHESS_BOARD_FILES || rayRank < 0 || rayRank >= CHESS_BOARD_RANKS)
+				break;
+
+			int8_t occupant = this->squareArray[MakeSquare(rayFile, rayRank)];
+			if (occupant == EMPTY)
+				continue;
+
+			if (occupant == slider * sign || occupant == QUEEN * sign || (j == 1 && occupant == KING * sign))
+				return true;
+
+			break;
+		}
+	}
+
+	return false;
+}
+
+bool ChessPlayoutBoard::IsInCheck(ChessColor color) const
+{
+	int square = this->kingSquare[int(color)];
+	if (square < 0)
+		return false;
+
+	ChessColor opponentColor = (color == ChessColor::White) ? ChessColor::Black : ChessColor::White;
+	return this->IsSquareAttacked(square, opponentColor);
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "ChessCommon.h"
+#include <type_traits>
+
+#define CHESS_PLAYOUT_MAX_MOVES		256
+
+namespace ChessEngine
+{
+	class ChessGame;
+	struct ChessGameSnapshot;
+
+	// A move as the playout board sees it.  It's just four bytes, so there's never any need to allocate one.
+	struct ChessPlayoutMove
+	{
+		enum Flag : uint8_t
+		{
+			CAPTURE = 0x01,
+			DOUBLE_STEP = 0x02,
+			EN_PASSANT = 0x04,
+			CASTLE = 0x08
+		};
+
+		// This packs the same way as ChessMove::Pack(), so the two can be compared.
+		ChessPackedMove Pack() const
+		{
+			int promotion = (this->promotedPiece != 0) ? this->promotedPiece - 1 : 0;
+			return ChessPackedMove(this->sourceSquare | (this->destinationSquare << 6) | (promotion << 12));
+		}
+
+		uint8_t sourceSquare;
+		uint8_t destinationSquare;
+		int8_t promotedPiece;		// One of the piece types of the playout board, or zero.
+		uint8_t flags;
+	};
+
+	// Which moves each side made over the course of a game, by where they went from and to.  (Which piece a pawn
+	// promoted to doesn't count.)  This is what RAVE needs to know about a random game.
+	struct ChessPlayoutMoveSet
+	{
+		void Clear()
+		{
+			for (int i = 0; i < 2; i++)
+				for (int j = 0; j < CHESS_BOARD_FILES * CHESS_BOARD_RANKS; j++)
+					this->destinationMask[i][j] = 0;
+		}
+
+		void Add(ChessColor color, ChessPackedMove move)
+		{
+			this->destinationMask[int(color)][move & 0x3F] |= uint64_t(1) << ((move >> 6) & 0x3F);
+		}
+
+		bool Contains(ChessColor color, ChessPackedMove move) const
+		{
+			return (this->destinationMask[int(color)][move & 0x3F] & (uint64_t(1) << ((move >> 6) & 0x3F))) != 0;
+		}
+
+		uint64_t destinationMask[2][CHESS_BOARD_FILES * CHESS_BOARD_RANKS];		// Indexed by color and source square.
+	};
+
+	// This is a stripped down chess board that's good for just one thing: playing random games as fast as
+	// we can, which is what MCTS roll-outs do all day long.  The ChessGame is built for flexibility: a heap
+	// object for every piece and move, and legality checked by trying each move and generating all of the
+	// opponent's replies.  That's fine for a search that looks at a few thousand positions, but not for
+	// playing out thousands of whole games a second.  Here, the board is a plain array of bytes, moves are
+	// generated into a buffer on the stack, and we only check the legality of the one move we randomly pick.
+	// Nothing here allocates.  The board is trivially copyable, so handing a copy to another thread, or
+	// trying a move on a scratch copy, is just a memcpy.
+	class CHESS_ENGINE_API ChessPlayoutBoard
+	{
+	public:
+		// Squares hold these, positive for white and negative for black.
+		enum Piece : int8_t
+		{
+			EMPTY = 0,
+			PAWN,
+			KNIGHT,
+			BISHOP,
+			ROOK,
+			QUEEN,
+			KING
+		};
+
+		enum CastlingRight : uint8_t
+		{
+			WHITE_KING_SIDE = 0x01,
+			WHITE_QUEEN_SIDE = 0x02,
+			BLACK_KING_SIDE = 0x04,
+			BLACK_QUEEN_SIDE = 0x08
+		};
+
+		// Copy the position out of the given game, with the given color to move.
+		void SetFromGame(const ChessGame* game, ChessColor whoseTurn);
+
+		// Copy the position out into a snapshot, which can be restored into a ChessGame.  Anything that only
+		// understands a ChessGame (an evaluation function, say) can look at the board that way.
+		void GetSnapshot(ChessGameSnapshot& snapshot) const;
+
+		// Play random moves until the game is over, or the given number of moves have been made, in which case
+		// we call it a draw.  Zero or less means no limit.  The result is from the favored color's point of
+		// view: 1 for a win, -1 for a loss and 0 for a draw.  The random state is advanced as we go.  If given
+		// a move set, the moves made are added to it.
+		double PlayRandomGame(ChessColor favoredColor, int maxMoves, uint64_t& randomState, ChessPlayoutMoveSet* moveSet = nullptr);
+
+		// Like the above, but if we run out of moves before the game is over, we return false and leave the
+		// board where we stopped, so that the caller can judge the position for itself.
+		bool PlayRandomMoves(ChessColor favoredColor, int maxMoves, uint64_t& randomState, double& gameResult, ChessPlayoutMoveSet* moveSet = nullptr);
+
+		// This scores the position exactly the way ChessAI::EvaluationFunction does (material, plus a little
+		// for each piece's distance from the edge of the board), just a lot faster.
+		int Evaluate(ChessColor favoredColor) const;
+
+		// Generate the moves of the side to move, barring the rules of check, except that castling is fully
+		// checked here.  The buffer must have room for CHESS_PLAYOUT_MAX_MOVES.  Returns the number of moves.
+		int GeneratePseudoLegalMoves(ChessPlayoutMove* moveArray) const;
+
+		// Like the above, but the moves that would leave our king in check are weeded out.
+		int GenerateLegalMoves(ChessPlayoutMove* moveArray) const;
+
+		// A quick guess at how worthwhile a move is to look at, for putting moves in order.  Bigger is better.
+		// Winning material comes first (the most valuable victim, taken by the least valuable attacker), then
+		// promotions, then everything else.
+		int GetMovePriority(const ChessPlayoutMove& move) const;
+
+		// Fill in the flags of a packed move, which are implied by the board.  The move isn't checked.
+		ChessPlayoutMove UnpackMove(ChessPackedMove packedMove) const;
+
+		// This also passes the turn to the other side.
+		void MakeMove(const ChessPlayoutMove& move);
+
+		bool IsSquareAttacked(int square, ChessColor attackerColor) const;
+		bool IsInCheck(ChessColor color) const;
+
+		// Return a Zobrist hash of the position, including who's to move and what castling and en-passant are still
+		// possible.  Like the one in ChessGame, this is calculated on demand.
+		uint64_t GetHashKey() const;
+
+		// This is the xorshift64* generator.  The state must never be zero.
+		static uint32_t NextRandom(uint64_t& randomState);
+
+		static int MakeSquare(int file, int rank) { return rank * CHESS_BOARD_FILES + file; }
+		static int GetFile(int square) { return square % CHESS_BOARD_FILES; }
+		static int GetRank(int square) { return square / CHESS_BOARD_FILES; }
+
+		int8_t squareArray[CHESS_BOARD_FILES * CHESS_BOARD_RANKS];
+		int8_t kingSquare[2];			// Indexed by color, or -1 if that color has no king.
+		int8_t enPassantFile;			// The file of a pawn that just made a double step, or -1.
+		uint8_t castlingRights;
+		ChessColor whoseTurn;
+		int numPieces;
+
+	private:
+
+		void AddMove(ChessPlayoutMove* moveArray, int& numMoves, int sourceSquare, int destinationSquare, uint8_t flags, int8_t promotedPiece = EMPTY) const;
+		void AddPawnMoves(ChessPlayoutMove* moveArray, int& numMoves, int sourceSquare, int destinationSquare, uint8_t flags) const;
+		void AddSlidingMoves(ChessPlayoutMove* moveArray, int& numMoves, int sourceSquare, const int(*directionArray)[2], int numDirections, int maxLength) const;
+	};
+
+	static_assert(std::is_trivially_copyable<ChessPlayoutBoard>::value, "The playout board must stay trivially copyable.");
+}
\ No newline at end of file
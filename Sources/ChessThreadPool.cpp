@@ -0,0 +1,202 @@
+#include "ChessThreadPool.h"
+#include <thread>
+
+using namespace ChessEngine;
+
+// These tell a thread which pool, if any, it works for, so that work it submits can go on its own deque.
+static thread_local const ChessThreadPool* currentPool = nullptr;
+static thread_local int currentWorkerIndex = -1;
+static thread_local uint32_t stealSeed = 0;
+
+//---------------------------------------- ChessThreadPool ----------------------------------------
+
+ChessThreadPool::ChessThreadPool(int numWorkers) : injectionQueue(4096), wakeSemaphore(1024)
+{
+	if (numWorkers <= 0)
+	{
+		numWorkers = int(std::thread::hardware_concurrency()) - 1;
+		if (numWorkers < 1)
+			numWorkers = 1;
+	}
+
+	this->sleepingCount.store(0);
+	this->shuttingDown.store(false);
+	this->workerArray = new std::vector<Worker*>();
+
+	for (int i = 0; i < numWorkers; i++)
+		this->workerArray->push_back(new Worker(this, i));
+
+	// Don't start anyone until all the deques exist, since the workers steal from each other.
+	for (Worker* worker : *this->workerArray)
+		worker->SpawnThread();
+}
+
+/*virtual*/ ChessThreadPool::~ChessThreadPool()
+{
+	this->shuttingDown.store(true);
+
+	for (int i = 0; i < (int)this->workerArray->size(); i++)
+		this->wakeSemaphore.Increment();
+
+	// Everyone has to be gone before anyone's deque goes away, since the others might be stealing from it.
+	for (Worker* worker : *this->workerArray)
+		worker->WaitForThreadExit();
+
+	for (Worker* worker : *this->workerArray)
+		delete worker;
+
+	delete this->workerArray;
+}
+
+/*static*/ ChessThreadPool* ChessThreadPool::Get()
+{
+	// This is leaked on purpose.  Joining threads while the process (or our DLL) is being torn down can hang.
+	static ChessThreadPool* pool = new ChessThreadPool(0);
+	return pool;
+}
+
+int ChessThreadPool::GetNumWorkers() const
+{
+	return (int)this->workerArray->size();
+}
+
+int ChessThreadPool::GetCurrentWorkerIndex() const
+{
+	return (currentPool == this) ? currentWorkerIndex : -1;
+}
+
+void ChessThreadPool::Submit(Task* task)
+{
+	int workerIndex = this->GetCurrentWorkerIndex();
+	if (workerIndex >= 0)
+		(*this->workerArray)[workerIndex]->deque.Push(task);
+	else if (!this->injectionQueue.TryPush(task))
+	{
+		// The pool is swamped, so the submitter can make itself useful.
+		this->Execute(task);
+		return;
+	}
+
+	// A worker says it's going to sleep before it takes one last look for work, and we publish the work
+	// before we look for sleepers, so between the two of us, one of us is sure to see the other.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (this->sleepingCount.load() > 0)
+		this->wakeSemaphore.Increment();
+}
+
+bool ChessThreadPool::FindTask(Task*& task)
+{
+	// Our own work comes first, newest first, since it's what we were just working on.
+	int workerIndex = this->GetCurrentWorkerIndex();
+	if (workerIndex >= 0 && (*this->workerArray)[workerIndex]->deque.Pop(task))
+		return true;
+
+	if (this->injectionQueue.TryPop(task))
+		return true;
+
+	// Now go through the other workers, starting with a random one, so that thieves don't all gang up on the same victim.
+	int numWorkers = (int)this->workerArray->size();
+	if (stealSeed == 0)
+		stealSeed = uint32_t(uintptr_t(&stealSeed)) | 1;
+	stealSeed ^= stealSeed << 13;
+	stealSeed ^= stealSeed >> 17;
+	stealSeed ^= stealSeed << 5;
+	int start = int(stealSeed % uint32_t(numWorkers));
+	for (int i = 0; i < numWorkers; i++)
+	{
+		int victimIndex = (start + i) % numWorkers;
+		if (victimIndex != workerIndex && (*this->workerArray)[victimIndex]->deque.Steal(task))
+			return true;
+	}
+
+	return false;
+}
+
+void ChessThreadPool::Execute(Task* task)
+{
+	TaskGroup* group = task->group;
+	task->function();
+	delete task;
+	group->pendingLatch.CountDown();
+}
+
+//---------------------------------------- ChessThreadPool::TaskGroup ----------------------------------------
+
+ChessThreadPool::TaskGroup::TaskGroup(ChessThreadPool* pool /*= nullptr*/)
+{
+	this->pool = pool ? pool : ChessThreadPool::Get();
+}
+
+/*virtual*/ ChessThreadPool::TaskGroup::~TaskGroup()
+{
+	// Our tasks point back at us, so we can't go away while any of them are outstanding.
+	this->Wait();
+}
+
+void ChessThreadPool::TaskGroup::Run(std::function<void()> function)
+{
+	Task* task = new Task{ function, this };
+	this->pendingLatch.Add(1);
+	this->pool->Submit(task);
+}
+
+void ChessThreadPool::TaskGroup::Wait()
+{
+	while (!this->pendingLatch.IsDone())
+	{
+		Task* task = nullptr;
+		if (this->pool->FindTask(task))
+			this->pool->Execute(task);
+		else
+		{
+			// What's left is in progress on other threads.  We don't park for long, since one of those
+			// tasks might hand out more work that we could be helping with.
+			this->pendingLatch.Wait(1.0);
+		}
+	}
+}
+
+//---------------------------------------- ChessThreadPool::Worker ----------------------------------------
+
+ChessThreadPool::Worker::Worker(ChessThreadPool* pool, int index)
+{
+	this->pool = pool;
+	this->index = index;
+}
+
+/*virtual*/ ChessThreadPool::Worker::~Worker()
+{
+}
+
+/*virtual*/ int ChessThreadPool::Worker::ThreadFunc()
+{
+	currentPool = this->pool;
+	currentWorkerIndex = this->index;
+
+	while (!this->pool->shuttingDown.load())
+	{
+		Task* task = nullptr;
+		if (this->pool->FindTask(task))
+		{
+			this->pool->Execute(task);
+			continue;
+		}
+
+		this->pool->sleepingCount.fetch_add(1);
+
+		if (this->pool->FindTask(task))
+		{
+			this->pool->sleepingCount.fetch_sub(1);
+			this->pool->Execute(task);
+			continue;
+		}
+
+		// The time-out is just a safety net.  We expect to be woken up by whoever submits more work.
+		this->pool->wakeSemaphore.Decrement(10.0);
+		this->pool->sleepingCount.fetch_sub(1);
+	}
+
+	currentPool = nullptr;
+	currentWorkerIndex = -1;
+	return 0;
+}
\ No newline at end of file
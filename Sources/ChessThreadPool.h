@@ -0,0 +1,230 @@
+#pragma once
+
+#include "ChessCommon.h"
+#include "ChessUtils.h"
+#include <atomic>
+#include <vector>
+#include <functional>
+
+namespace ChessEngine
+{
+	// This is the Chase-Lev work-stealing deque.  Only the thread that owns it may push and pop, and it does
+	// so at the bottom, like a stack, which keeps it working on whatever it touched most recently.  Any other
+	// thread may steal from the top, which is where the oldest (and usually biggest) pieces of work are.
+	// None of this takes a lock.  The owner and the thieves only contend over the very last item.
+	//
+	// Useful resources:
+	//		* Chase & Lev, "Dynamic Circular Work-Stealing Deque" (2005)
+	//		* Le, Pop, Cohen & Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models" (2013)
+	template<typename T>
+	class WorkStealingDeque
+	{
+	public:
+		// The capacity is rounded up to a power of two, and it grows as needed.
+		WorkStealingDeque(int64_t capacity = 256)
+		{
+			int64_t size = 1;
+			while (size < capacity)
+				size <<= 1;
+
+			this->top.store(0, std::memory_order_relaxed);
+			this->bottom.store(0, std::memory_order_relaxed);
+			this->array.store(new Array(size), std::memory_order_relaxed);
+			this->retiredArrays = new std::vector<Array*>();
+		}
+
+		virtual ~WorkStealingDeque()
+		{
+			delete this->array.load(std::memory_order_relaxed);
+			for (Array* retiredArray : *this->retiredArrays)
+				delete retiredArray;
+			delete this->retiredArrays;
+		}
+
+		// Only the owning thread may call this.
+		void Push(T value)
+		{
+			int64_t b = this->bottom.load(std::memory_order_relaxed);
+			int64_t t = this->top.load(std::memory_order_acquire);
+			Array* a = this->array.load(std::memory_order_relaxed);
+			if (b - t > a->size - 1)
+			{
+				// A thief may still be reading the old array, so we can't free it until we're destroyed.
+				Array* grownArray = a->Grow(t, b);
+				this->retiredArrays->push_back(a);
+				a = grownArray;
+				this->array.store(a, std::memory_order_release);
+			}
+
+			a->Put(b, value);
+			this->bottom.store(b + 1, std::memory_order_release);
+		}
+
+		// Only the owning thread may call this.  It takes the most recently pushed item.
+		bool Pop(T& value)
+		{
+			int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+			Array* a = this->array.load(std::memory_order_relaxed);
+			this->bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = this->top.load(std::memory_order_relaxed);
+
+			if (t > b)
+			{
+				// It was already empty.
+				this->bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			value = a->Get(b);
+			if (t == b)
+			{
+				// This was the last item, so we have to race any thieves for it.
+				bool won = this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				this->bottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+
+			return true;
+		}
+
+		// Any thread may call this.  It takes the oldest item.  Note that this can fail on a deque that
+		// isn't empty if we lose a race, so don't take failure to mean there's nothing left.
+		bool Steal(T& value)
+		{
+			int64_t t = this->top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = this->bottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return false;
+
+			Array* a = this->array.load(std::memory_order_acquire);
+			value = a->Get(t);
+			return this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		// This is only a hint when other threads are using the deque.
+		bool IsEmpty() const
+		{
+			int64_t b = this->bottom.load(std::memory_order_relaxed);
+			int64_t t = this->top.load(std::memory_order_relaxed);
+			return b <= t;
+		}
+
+	private:
+
+		struct Array
+		{
+			Array(int64_t size)
+			{
+				this->size = size;
+				this->buffer = new std::atomic<T>[size];
+			}
+
+			~Array()
+			{
+				delete[] this->buffer;
+			}
+
+			T Get(int64_t i) const
+			{
+				return this->buffer[i & (this->size - 1)].load(std::memory_order_relaxed);
+			}
+
+			void Put(int64_t i, T value)
+			{
+				this->buffer[i & (this->size - 1)].store(value, std::memory_order_relaxed);
+			}
+
+			Array* Grow(int64_t t, int64_t b) const
+			{
+				Array* grownArray = new Array(this->size * 2);
+				for (int64_t i = t; i < b; i++)
+					grownArray->Put(i, this->Get(i));
+				return grownArray;
+			}
+
+			int64_t size;
+			std::atomic<T>* buffer;
+		};
+
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::atomic<Array*> array;
+		std::vector<Array*>* retiredArrays;
+	};
+
+	// One pool of worker threads for the whole engine, created once and kept for the life of the process.
+	// Anything that wants to spread work over the cores (MCTS roll-outs, parallel search, batch analysis)
+	// should hand its work here rather than spin up threads of its own.  Each worker keeps its own deque of
+	// tasks.  Tasks submitted from a worker go on that worker's deque.  Tasks submitted from anywhere else go
+	// on a shared (lock-free, bounded) queue.  If that queue is ever full, the submitter just runs the task
+	// itself.  A worker with nothing to do steals from the others before it goes to sleep.
+	class CHESS_ENGINE_API ChessThreadPool
+	{
+	public:
+		// Zero or less workers means one less than the number of hardware threads, since whoever is waiting
+		// on a task group lends a hand too.
+		ChessThreadPool(int numWorkers);
+		virtual ~ChessThreadPool();
+
+		// This is the engine-wide pool.  It is created on first use and never destroyed.
+		static ChessThreadPool* Get();
+
+		int GetNumWorkers() const;
+
+		// Work is handed to the pool in groups, so that the caller can wait for just the work it gave.
+		class CHESS_ENGINE_API TaskGroup
+		{
+		public:
+			// A null pool means the engine-wide pool.
+			TaskGroup(ChessThreadPool* pool = nullptr);
+			virtual ~TaskGroup();
+
+			void Run(std::function<void()> function);
+
+			// Return once every task run in this group is done.  Rather than block, the calling thread
+			// executes tasks (any tasks, not just ours) until then.  It's fine to do this from a task.
+			// If there's nothing left to help with, we park until our last task finishes.
+			void Wait();
+
+		private:
+			friend class ChessThreadPool;
+
+			ChessThreadPool* pool;
+			CountdownLatch pendingLatch;
+		};
+
+	private:
+
+		struct Task
+		{
+			std::function<void()> function;
+			TaskGroup* group;
+		};
+
+		class Worker : public Thread
+		{
+		public:
+			Worker(ChessThreadPool* pool, int index);
+			virtual ~Worker();
+
+			virtual int ThreadFunc() override;
+
+			ChessThreadPool* pool;
+			int index;
+			WorkStealingDeque<Task*> deque;
+		};
+
+		void Submit(Task* task);
+		bool FindTask(Task*& task);
+		void Execute(Task* task);
+		int GetCurrentWorkerIndex() const;
+
+		std::vector<Worker*>* workerArray;
+		MPMCQueue<Task*> injectionQueue;
+		Semaphore wakeSemaphore;
+		std::atomic<int> sleepingCount;
+		std::atomic<bool> shuttingDown;
+	};
+}
\ No newline at end of file
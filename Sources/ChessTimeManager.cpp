@@ -0,0 +1,115 @@
+#include "ChessTimeManager.h"
+#include "ChessMove.h"
+
+using namespace ChessEngine;
+
+ChessTimeManager::ChessTimeManager()
+{
+	this->overheadSeconds = 0.05;
+	this->defaultMovesToGo = 30;
+	this->maxStretchFactor = 4.0;
+
+	this->End();
+}
+
+/*virtual*/ ChessTimeManager::~ChessTimeManager()
+{
+}
+
+void ChessTimeManager::Begin(double timeLeftSeconds, double incrementSeconds, int movesToGo)
+{
+	this->End();
+
+	if (timeLeftSeconds <= 0.0)
+		return;
+
+	this->active = true;
+
+	if (movesToGo <= 0)
+		movesToGo = this->defaultMovesToGo;
+
+	// Never plan on using the time we know we'll lose to overhead.  Note that the increment isn't added
+	// to the usable time, because we don't get it until after we've moved.
+	double usableSeconds = timeLeftSeconds - this->overheadSeconds;
+	if (usableSeconds < 0.001)
+		usableSeconds = 0.001;
+
+	double nominalSeconds = usableSeconds / double(movesToGo) + ((movesToGo > 1) ? incrementSeconds * 0.75 : 0.0);
+
+	// The closer we are to the time control, the bigger the share of what's left we can afford to blow on one move.
+	double hardShare = 3.0 / double(movesToGo);
+	if (hardShare > 0.8)
+		hardShare = 0.8;
+
+	this->hardLimitSeconds = nominalSeconds * this->maxStretchFactor;
+	if (this->hardLimitSeconds > usableSeconds * hardShare)
+		this->hardLimitSeconds = usableSeconds * hardShare;
+	if (this->hardLimitSeconds < nominalSeconds)
+		this->hardLimitSeconds = nominalSeconds;
+	if (this->hardLimitSeconds > usableSeconds)
+		this->hardLimitSeconds = usableSeconds;
+
+	this->softLimitSeconds = (nominalSeconds < this->hardLimitSeconds) ? nominalSeconds : this->hardLimitSeconds;
+}
+
+void ChessTimeManager::End()
+{
+	this->active = false;
+	this->softLimitSeconds = 0.0;
+	this->hardLimitSeconds = 0.0;
+	this->instability = 0.0;
+	this->scale = 1.0;
+	this->hasRecaptureLocation = false;
+	this->lastBestMove = CHESS_PACKED_MOVE_NONE;
+	this->stableIterationCount = 0;
+}
+
+void ChessTimeManager::SetSingleReply()
+{
+	// We still let the engine finish one unit of work, if only to come up with something to ponder.
+	this->scale = 0.0;
+}
+
+void ChessTimeManager::SetRecaptureLocation(const ChessVector& location)
+{
+	this->hasRecaptureLocation = true;
+	this->recaptureLocation = location;
+}
+
+void ChessTimeManager::OnIterationComplete(ChessPackedMove bestMove)
+{
+	// Changes of mind count for a lot at first, but are forgotten quickly if things settle down.
+	bool changed = (this->lastBestMove != CHESS_PACKED_MOVE_NONE && bestMove != this->lastBestMove);
+	this->instability = this->instability * 0.5 + (changed ? 1.0 : 0.0);
+
+	if (changed)
+		this->stableIterationCount = 0;
+	else
+		this->stableIterationCount++;
+
+	this->lastBestMove = bestMove;
+}
+
+double ChessTimeManager::GetSoftLimitSeconds() const
+{
+	double softLimitSeconds = this->softLimitSeconds * this->scale * (1.0 + this->instability);
+
+	if (this->hasRecaptureLocation && this->lastBestMove != CHESS_PACKED_MOVE_NONE && this->stableIterationCount >= 2)
+		if (ChessMove::UnpackDestinationLocation(this->lastBestMove) == this->recaptureLocation)
+			softLimitSeconds *= 0.4;
+
+	if (softLimitSeconds > this->hardLimitSeconds)
+		softLimitSeconds = this->hardLimitSeconds;
+
+	return softLimitSeconds;
+}
+
+bool ChessTimeManager::SoftLimitReached(double elapsedSeconds) const
+{
+	return this->active && elapsedSeconds >= this->GetSoftLimitSeconds();
+}
+
+bool ChessTimeManager::HardLimitReached(double elapsedSeconds) const
+{
+	return this->active && elapsedSeconds >= this->hardLimitSeconds;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ChessCommon.h"
+
+namespace ChessEngine
+{
+	// This decides how much of a game clock to spend on a single move.  There are two limits.  The soft
+	// limit is checked between units of work (e.g., iterations of a deepening search), and is what we
+	// aim for.  It gets stretched when the engine keeps changing its mind, and shrunk when the move is
+	// forced or obvious.  The hard limit is checked in the middle of the search, and is never exceeded,
+	// because running out the clock loses the game no matter how good the move would have been.
+	class CHESS_ENGINE_API ChessTimeManager
+	{
+	public:
+		ChessTimeManager();
+		virtual ~ChessTimeManager();
+
+		// Budget the next move.  A non-positive time left means there's no clock, and then we're inactive.
+		void Begin(double timeLeftSeconds, double incrementSeconds, int movesToGo);
+		void End();
+
+		bool IsActive() const { return this->active; }
+
+		// If there's only one legal move, there's nothing to think about.
+		void SetSingleReply();
+
+		// If the opponent just captured on the given square, then taking back is often the obvious thing to do.
+		void SetRecaptureLocation(const ChessVector& location);
+
+		// The engine should call this each time it finishes a unit of work with its current best move.
+		void OnIterationComplete(ChessPackedMove bestMove);
+
+		bool SoftLimitReached(double elapsedSeconds) const;
+		bool HardLimitReached(double elapsedSeconds) const;
+
+		double GetSoftLimitSeconds() const;
+		double GetHardLimitSeconds() const { return this->hardLimitSeconds; }
+
+		double overheadSeconds;			// Time lost per move to latency, etc., that we should never plan to use.
+		int defaultMovesToGo;			// How many more moves we assume there are when the clock doesn't say.
+		double maxStretchFactor;		// How far past the nominal budget the hard limit can go.
+
+	private:
+
+		bool active;
+		double softLimitSeconds;
+		double hardLimitSeconds;
+		double instability;
+		double scale;
+		bool hasRecaptureLocation;
+		ChessVector recaptureLocation;
+		ChessPackedMove lastBestMove;
+		int stableIterationCount;
+	};
+}
\ No newline at end of file
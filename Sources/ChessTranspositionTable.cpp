@@ -0,0 +1,77 @@
+#include "ChessTranspositionTable.h"
+
+using namespace ChessEngine;
+
+ChessTranspositionTable::ChessTranspositionTable(int numEntries)
+{
+	this->numEntries = 1;
+	while (this->numEntries * 2 <= numEntries)
+		this->numEntries *= 2;
+
+	this->entryArray = new Entry[this->numEntries];
+	this->Clear();
+}
+
+/*virtual*/ ChessTranspositionTable::~ChessTranspositionTable()
+{
+	delete[] this->entryArray;
+}
+
+void ChessTranspositionTable::Clear()
+{
+	this->generation = 0;
+
+	for (int i = 0; i < this->numEntries; i++)
+	{
+		Entry* entry = &this->entryArray[i];
+		entry->keyCheck = 0;
+		entry->value = 0;
+		entry->move = CHESS_PACKED_MOVE_NONE;
+		entry->draft = 0;
+		entry->distance = 0;
+		entry->bound = Bound::NONE;
+		entry->generation = 0;
+	}
+}
+
+void ChessTranspositionTable::NewSearch()
+{
+	this->generation++;
+}
+
+const ChessTranspositionTable::Entry* ChessTranspositionTable::Probe(uint64_t hashKey) const
+{
+	const Entry* entry = &this->entryArray[hashKey & uint64_t(this->numEntries - 1)];
+	if (entry->bound == Bound::NONE || entry->keyCheck != uint32_t(hashKey >> 32))
+		return nullptr;
+
+	return entry;
+}
+
+void ChessTranspositionTable::Store(uint64_t hashKey, int value, int distance, int draft, Bound bound, ChessPackedMove move)
+{
+	Entry* entry = &this->entryArray[hashKey & uint64_t(this->numEntries - 1)];
+	uint32_t keyCheck = uint32_t(hashKey >> 32);
+
+	// A deeper search of some other position is worth more to us than a shallower search of this one,
+	// but only if it was done during this search.  Anything older is fair game.
+	if (entry->bound != Bound::NONE && entry->keyCheck != keyCheck && entry->generation == this->generation && entry->draft > draft)
+		return;
+
+	// Don't lose the best move we knew of for this position just because this search didn't come up with one.
+	if (move == CHESS_PACKED_MOVE_NONE && entry->keyCheck == keyCheck)
+		move = entry->move;
+
+	if (distance > INT8_MAX)
+		distance = INT8_MAX;
+	if (draft > INT8_MAX)
+		draft = INT8_MAX;
+
+	entry->keyCheck = keyCheck;
+	entry->value = value;
+	entry->move = move;
+	entry->draft = int8_t(draft);
+	entry->distance = int8_t(distance);
+	entry->bound = bound;
+	entry->generation = this->generation;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ChessCommon.h"
+
+namespace ChessEngine
+{
+	// This remembers what the search learned about positions it has already been to, keyed on their hash.
+	// It is meant to outlive any one search, so that the next search (usually two plies further into the
+	// same game) can pick up where the last one left off.  Entries aren't cleared between searches.  They
+	// just get older, and old entries are the first to be replaced.
+	class CHESS_ENGINE_API ChessTranspositionTable
+	{
+	public:
+		// The number of entries is rounded down to a power of two.
+		ChessTranspositionTable(int numEntries);
+		virtual ~ChessTranspositionTable();
+
+		enum class Bound : uint8_t
+		{
+			NONE,
+			EXACT,
+			LOWER,		// The true score is at least this.
+			UPPER		// The true score is at most this.
+		};
+
+		struct Entry
+		{
+			uint32_t keyCheck;			// The high bits of the key, since the low bits chose the slot.
+			int32_t value;
+			ChessPackedMove move;
+			int8_t draft;				// How many plies were searched below the position.
+			int8_t distance;			// How many plies below the position the score was found.
+			Bound bound;
+			uint8_t generation;
+		};
+
+		// The entry is only good until the next store.
+		const Entry* Probe(uint64_t hashKey) const;
+		void Store(uint64_t hashKey, int value, int distance, int draft, Bound bound, ChessPackedMove move);
+
+		// Call this at the start of each search.  Anything stored before is now considered aged.
+		void NewSearch();
+
+		// Forget everything.
+		void Clear();
+
+		int GetNumEntries() const { return this->numEntries; }
+
+	private:
+
+		Entry* entryArray;
+		int numEntries;
+		uint8_t generation;
+	};
+}
\ No newline at end of file
@@ -1,5 +1,15 @@
 #include "ChessUtils.h"
 #include <string.h>
+#include <thread>
+#if defined __WINDOWS__
+#   pragma comment(lib, "Synchronization.lib")
+#elif defined __LINUX__
+#   include <time.h>
+#   include <errno.h>
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#   include <linux/futex.h>
+#endif
 
 using namespace ChessEngine;
 
@@ -10,6 +20,7 @@ Thread::Thread()
 #elif defined __LINUX__
     memset(&this->thread, 0, sizeof(this->thread));
     this->threadRunning = false;
+    this->threadExited.store(false);
 #endif
 }
 
@@ -23,10 +34,21 @@ Thread::Thread()
 #if defined __WINDOWS__
     ::Sleep((DWORD)timeoutMilliseconds);
 #elif defined __LINUX__
-    // TODO: Write this.
+    struct timespec remaining;
+    remaining.tv_sec = time_t(timeoutMilliseconds / 1000.0);
+    remaining.tv_nsec = long((timeoutMilliseconds - double(remaining.tv_sec) * 1000.0) * 1000000.0);
+    while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR)
+    {
+    }
 #endif
 }
 
+/*static*/ int Thread::GetSpinCount()
+{
+    static int spinCount = (std::thread::hardware_concurrency() > 1) ? CHESS_SPIN_COUNT_BEFORE_PARKING : 0;
+    return spinCount;
+}
+
 bool Thread::SpawnThread()
 {
 #if defined __WINDOWS__
@@ -40,6 +62,7 @@ bool Thread::SpawnThread()
     if (this->threadRunning)
         return false;
 
+    this->threadExited.store(false);
     int result = pthread_create(&this->thread, nullptr, &Thread::ThreadMain, this);
     if (result != 0)
         return false;
@@ -79,7 +102,13 @@ void Thread::KillThread(void)
         this->threadHandle = nullptr;
     }
 #elif defined __LINUX__
-    // TODO: Write this.
+    if (this->threadRunning)
+    {
+        if (!this->threadExited.load())
+            pthread_cancel(this->thread);
+        pthread_join(this->thread, nullptr);
+        this->threadRunning = false;
+    }
 #endif
 }
 
@@ -96,7 +125,7 @@ bool Thread::IsStillRunning(void)
 
     return true;
 #elif defined __LINUX__
-    return this->threadRunning;
+    return this->threadRunning && !this->threadExited.load();
 #endif
 }
 
@@ -111,7 +140,53 @@ bool Thread::IsStillRunning(void)
 {
     Thread* thread = (Thread*)arg;
     thread->ThreadFunc();
-    thread->threadRunning = false;
+
+    // We don't clear the running flag here, because the thread still has to be joined.
+    thread->threadExited.store(true);
     return nullptr;
 }
-#endif
\ No newline at end of file
+#endif
+
+/*static*/ bool Futex::Wait(std::atomic<int32_t>* address, int32_t expected, double timeoutMilliseconds /*= -1.0*/)
+{
+#if defined __WINDOWS__
+    static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "We assume the atomic is just the value.");
+    DWORD timeout = (timeoutMilliseconds >= 0.0) ? (DWORD)timeoutMilliseconds : INFINITE;
+    if (::WaitOnAddress(address, &expected, sizeof(int32_t), timeout))
+        return true;
+    return ::GetLastError() != ERROR_TIMEOUT;
+#elif defined __LINUX__
+    static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "We assume the atomic is just the value.");
+    struct timespec timeout;
+    struct timespec* timeoutPtr = nullptr;
+    if (timeoutMilliseconds >= 0.0)
+    {
+        timeout.tv_sec = time_t(timeoutMilliseconds / 1000.0);
+        timeout.tv_nsec = long((timeoutMilliseconds - double(timeout.tv_sec) * 1000.0) * 1000000.0);
+        timeoutPtr = &timeout;
+    }
+
+    // The kernel checks the value again under its own lock, so we can't miss a wake-up in between our
+    // check and going to sleep.  If the value has already changed, we just return right away.
+    long result = syscall(SYS_futex, (int32_t*)address, FUTEX_WAIT_PRIVATE, expected, timeoutPtr, nullptr, 0);
+    return result == 0 || errno != ETIMEDOUT;
+#endif
+}
+
+/*static*/ void Futex::WakeOne(std::atomic<int32_t>* address)
+{
+#if defined __WINDOWS__
+    ::WakeByAddressSingle(address);
+#elif defined __LINUX__
+    syscall(SYS_futex, (int32_t*)address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+/*static*/ void Futex::WakeAll(std::atomic<int32_t>* address)
+{
+#if defined __WINDOWS__
+    ::WakeByAddressAll(address);
+#elif defined __LINUX__
+    syscall(SYS_futex, (int32_t*)address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
\ No newline at end of file
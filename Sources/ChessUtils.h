@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <atomic>
 #include "ChessCommon.h"
 #if defined __WINDOWS__
 #	include <Windows.h>
@@ -34,6 +35,23 @@ namespace ChessEngine
 
 		static void Sleep(double timeoutMilliseconds);
 
+		// This is how long to spin before parking.  It's zero on a single-core machine, where spinning
+		// just burns the time slice of the thread we're waiting on.
+		static int GetSpinCount();
+
+		// Call this in the body of a spin loop.  It tells the CPU we're spinning, which saves power and
+		// gets out of the way of a hyper-thread sibling that might be the one we're waiting on.
+		static inline void CpuRelax()
+		{
+#if defined __WINDOWS__
+			YieldProcessor();
+#elif defined __x86_64__ || defined __i386__
+			__builtin_ia32_pause();
+#elif defined __aarch64__
+			asm volatile("yield");
+#endif
+		}
+
 	private:
 
 #if defined __WINDOWS__
@@ -42,10 +60,30 @@ namespace ChessEngine
 #elif defined __LINUX__
 		static void* ThreadMain(void* arg);
 		pthread_t thread;
-		volatile bool threadRunning;
+		volatile bool threadRunning;		// Spawned and not yet joined.
+		std::atomic<bool> threadExited;
 #endif
 	};
 
+	// This is the thinnest wrapper we can put around the OS's ability to put a thread to sleep until some
+	// 32-bit value in memory changes.  It's a futex on Linux and WaitOnAddress() on Windows.  No bookkeeping
+	// is done here, so the callers have to be careful not to miss a wake-up, and they must tolerate waking
+	// up for no reason.
+	class CHESS_ENGINE_API Futex
+	{
+	public:
+		// Sleep so long as the given address still holds the expected value.  This returns false on time-out.
+		static bool Wait(std::atomic<int32_t>* address, int32_t expected, double timeoutMilliseconds = -1.0);
+
+		static void WakeOne(std::atomic<int32_t>* address);
+		static void WakeAll(std::atomic<int32_t>* address);
+	};
+
+	// How many times the primitives below check for what they're waiting for before they ask the OS to park
+	// the thread.  Handoffs between busy threads usually happen within this many spins, and a spin is a lot
+	// cheaper than a trip through the kernel.  See Thread::GetSpinCount().
+#define CHESS_SPIN_COUNT_BEFORE_PARKING		256
+
 	class CHESS_ENGINE_API Semaphore
 	{
 	public:
@@ -54,7 +92,9 @@ namespace ChessEngine
 #if defined __WINDOWS__
 			this->semaphoreHandle = ::CreateSemaphore(NULL, 0, count, NULL);
 #elif defined __LINUX__
-			// TODO: Write this.
+			this->count.store(0);
+			this->maxCount = count;
+			this->numWaiters.store(0);
 #endif
 		}
 
@@ -69,6 +109,17 @@ namespace ChessEngine
 		{
 #if defined __WINDOWS__
 			::ReleaseSemaphore(this->semaphoreHandle, 1, NULL);
+#elif defined __LINUX__
+			// Like the Windows semaphore, incrementing past the maximum count does nothing.
+			int32_t oldCount = this->count.load();
+			do
+			{
+				if (oldCount >= this->maxCount)
+					return;
+			} while (!this->count.compare_exchange_weak(oldCount, oldCount + 1));
+
+			if (this->numWaiters.load() > 0)
+				Futex::WakeOne(&this->count);
 #endif
 		}
 
@@ -76,11 +127,47 @@ namespace ChessEngine
 		{
 #if defined __WINDOWS__
 			return WAIT_OBJECT_0 == ::WaitForSingleObject(this->semaphoreHandle, (timeoutMilliseconds >= 0.0f) ? (DWORD)timeoutMilliseconds : INFINITE);
+#elif defined __LINUX__
+			for (int i = Thread::GetSpinCount(); i > 0; i--)
+			{
+				if (this->TryDecrement())
+					return true;
+				Thread::CpuRelax();
+			}
+
+			if (timeoutMilliseconds == 0.0)
+				return this->TryDecrement();
+
+			// We announce ourselves before we look one last time, and the incrementer looks for us after it
+			// increments, so one of us is sure to see the other.  The futex won't sleep if the count isn't zero.
+			bool decremented = false;
+			this->numWaiters.fetch_add(1);
+			while (!(decremented = this->TryDecrement()))
+				if (!Futex::Wait(&this->count, 0, timeoutMilliseconds) && timeoutMilliseconds > 0.0)
+					break;
+			if (!decremented)
+				decremented = this->TryDecrement();
+			this->numWaiters.fetch_sub(1);
+			return decremented;
 #endif
 		}
 
 #if defined __WINDOWS__
 		HANDLE semaphoreHandle;
+#elif defined __LINUX__
+	private:
+		bool TryDecrement()
+		{
+			int32_t oldCount = this->count.load();
+			while (oldCount > 0)
+				if (this->count.compare_exchange_weak(oldCount, oldCount - 1, std::memory_order_acquire))
+					return true;
+			return false;
+		}
+
+		std::atomic<int32_t> count;
+		int32_t maxCount;
+		std::atomic<int32_t> numWaiters;
 #endif
 	};
 
@@ -146,7 +233,8 @@ namespace ChessEngine
 #if defined __WINDOWS__
 			this->eventHandle = CreateEvent(NULL, FALSE, FALSE, NULL);
 #elif defined __LINUX__
-			// TODO: Write this.
+			this->signaled.store(0);
+			this->numWaiters.store(0);
 #endif
 		}
 
@@ -162,6 +250,11 @@ namespace ChessEngine
 		{
 #if defined __WINDOWS__
 			SetEvent(this->eventHandle);
+#elif defined __LINUX__
+			// Like the Windows event, this is auto-reset, so it lets exactly one waiter through.
+			this->signaled.store(1);
+			if (this->numWaiters.load() > 0)
+				Futex::WakeOne(&this->signaled);
 #endif
 		}
 
@@ -169,6 +262,18 @@ namespace ChessEngine
 		{
 #if defined __WINDOWS__
 			WaitForSingleObject(this->eventHandle, INFINITE);
+#elif defined __LINUX__
+			for (int i = Thread::GetSpinCount(); i > 0; i--)
+			{
+				if (this->TryReset())
+					return;
+				Thread::CpuRelax();
+			}
+
+			this->numWaiters.fetch_add(1);
+			while (!this->TryReset())
+				Futex::Wait(&this->signaled, 0);
+			this->numWaiters.fetch_sub(1);
 #endif
 		}
 
@@ -182,15 +287,85 @@ namespace ChessEngine
 				handleArray[i] = eventArray[i]->eventHandle;
 			WaitForMultipleObjects(eventArray.size(), handleArray, TRUE, INFINITE);
 			delete[] handleArray;
+#elif defined __LINUX__
+			// We're waiting for all of them, so it doesn't matter what order we go in.
+			for (Event* event : eventArray)
+				event->Wait();
 #endif
 		}
 
 	private:
 #if defined __WINDOWS__
 		HANDLE eventHandle;
+#elif defined __LINUX__
+		bool TryReset()
+		{
+			int32_t expected = 1;
+			return this->signaled.compare_exchange_strong(expected, 0, std::memory_order_acquire);
+		}
+
+		std::atomic<int32_t> signaled;
+		std::atomic<int32_t> numWaiters;
 #endif
 	};
 
+	// This lets a thread wait for some number of things to get done, which is what you'd otherwise need an
+	// event per thing for.  The count can be added to as work is handed out, so long as nobody expects the
+	// wait to be over in the meantime.  Waiters spin for a bit before they park, since the wait is often short.
+	class CHESS_ENGINE_API CountdownLatch
+	{
+	public:
+		CountdownLatch(int32_t count = 0)
+		{
+			this->count.store(count);
+		}
+
+		virtual ~CountdownLatch()
+		{
+		}
+
+		void Add(int32_t amount = 1)
+		{
+			this->count.fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		// Note that the latch may be gone by the time this returns, if this was the last count and a waiter
+		// was quick to destroy it, so be careful not to touch it again.
+		void CountDown()
+		{
+			if (this->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				Futex::WakeAll(&this->count);
+		}
+
+		bool IsDone() const
+		{
+			return this->count.load(std::memory_order_acquire) <= 0;
+		}
+
+		// This returns false if we time out before the count gets down to zero.
+		bool Wait(double timeoutMilliseconds = -1.0)
+		{
+			for (int i = Thread::GetSpinCount(); i > 0; i--)
+			{
+				if (this->IsDone())
+					return true;
+				Thread::CpuRelax();
+			}
+
+			while (true)
+			{
+				int32_t currentCount = this->count.load(std::memory_order_acquire);
+				if (currentCount <= 0)
+					return true;
+				if (!Futex::Wait(&this->count, currentCount, timeoutMilliseconds) && timeoutMilliseconds >= 0.0)
+					return this->IsDone();
+			}
+		}
+
+	private:
+		std::atomic<int32_t> count;
+	};
+
 	template<typename T>
 	class CHESS_ENGINE_API LinkedList
 	{
@@ -384,6 +559,7 @@ namespace ChessEngine
 
 		ThreadSafeList()
 		{
+			this->count.store(0);
 		}
 
 		virtual ~ThreadSafeList()
@@ -392,31 +568,34 @@ namespace ChessEngine
 
 		uint32_t GetCount() const
 		{
-			return this->linkedList.GetCount();
+			return this->count.load();
 		}
 
 		void AddTail(T value)
 		{
 			MutexLocker locker(this->mutex);
 			this->linkedList.AddTail(value);
+			this->count.store(this->linkedList.GetCount());
 		}
 
 		void AddHead(T value)
 		{
 			MutexLocker locker(this->mutex);
 			this->linkedList.AddHead(value);
+			this->count.store(this->linkedList.GetCount());
 		}
 
 		bool RemoveTail(T& value)
 		{
 			bool removed = false;
-			if (this->linkedList.GetCount() > 0)	// Avoid mutex luck if unnecessary.
+			if (this->count.load() > 0)	// Avoid mutex luck if unnecessary.
 			{
 				MutexLocker locker(this->mutex);
 				if (this->linkedList.GetCount() > 0)	// Avoid race condition.
 				{
 					value = this->linkedList.GetTail()->value;
 					this->linkedList.Remove(this->linkedList.GetTail());
+					this->count.store(this->linkedList.GetCount());
 					removed = true;
 				}
 			}
@@ -426,13 +605,14 @@ namespace ChessEngine
 		bool RemoveHead(T& value)
 		{
 			bool removed = false;
-			if (this->linkedList.GetCount() > 0)	// Avoid mutex luck if unnecessary.
+			if (this->count.load() > 0)	// Avoid mutex luck if unnecessary.
 			{
 				MutexLocker locker(this->mutex);
 				if (this->linkedList.GetCount() > 0)	// Avoid race condition.
 				{
 					value = this->linkedList.GetHead()->value;
 					this->linkedList.Remove(this->linkedList.GetHead());
+					this->count.store(this->linkedList.GetCount());
 					removed = true;
 				}
 			}
@@ -443,17 +623,208 @@ namespace ChessEngine
 		{
 			MutexLocker locker(this->mutex);
 			DeleteList<T>(this->linkedList);
+			this->count.store(0);
 		}
 
 		T Find(std::function<bool(T)> predicate, T notFoundValue, bool removeIfFound = false)
 		{
 			MutexLocker locker(this->mutex);
-			return this->linkedList.Find(predicate, notFoundValue, removeIfFound);
+			T returnValue = this->linkedList.Find(predicate, notFoundValue, removeIfFound);
+			this->count.store(this->linkedList.GetCount());
+			return returnValue;
 		}
 
 	private:
 
 		Mutex mutex;
 		LinkedList<T> linkedList;
+
+		// This mirrors the count of the list, but it's safe to read without the lock.
+		std::atomic<uint32_t> count;
+	};
+
+	// This is Dmitry Vyukov's bounded multi-producer, multi-consumer queue.  Unlike the ThreadSafeList, it
+	// never takes a lock and never allocates once it's made.  Every slot carries a sequence number that says
+	// whose turn it is to use it, so producers and consumers only ever contend over the head or tail index.
+	// The price is that it has a fixed capacity, so be ready for a push to fail.
+	//
+	// Useful resources:
+	//		* https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+	template<typename T>
+	class CHESS_ENGINE_API MPMCQueue
+	{
+	public:
+		// The capacity is rounded up to a power of two.
+		MPMCQueue(uint32_t capacity)
+		{
+			uint32_t size = 2;
+			while (size < capacity)
+				size <<= 1;
+
+			this->mask = size - 1;
+			this->cellArray = new Cell[size];
+			for (uint32_t i = 0; i < size; i++)
+				this->cellArray[i].sequence.store(i, std::memory_order_relaxed);
+
+			this->enqueuePosition.store(0, std::memory_order_relaxed);
+			this->dequeuePosition.store(0, std::memory_order_relaxed);
+		}
+
+		virtual ~MPMCQueue()
+		{
+			delete[] this->cellArray;
+		}
+
+		// This returns false if the queue is full.
+		bool TryPush(const T& value)
+		{
+			Cell* cell = nullptr;
+			uint32_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell = &this->cellArray[position & this->mask];
+				uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+				int32_t difference = int32_t(sequence - position);
+				if (difference == 0)
+				{
+					if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (difference < 0)
+					return false;
+				else
+					position = this->enqueuePosition.load(std::memory_order_relaxed);
+			}
+
+			cell->value = value;
+			cell->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		// This returns false if the queue is empty.
+		bool TryPop(T& value)
+		{
+			Cell* cell = nullptr;
+			uint32_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell = &this->cellArray[position & this->mask];
+				uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+				int32_t difference = int32_t(sequence - (position + 1));
+				if (difference == 0)
+				{
+					if (this->dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (difference < 0)
+					return false;
+				else
+					position = this->dequeuePosition.load(std::memory_order_relaxed);
+			}
+
+			value = cell->value;
+			cell->sequence.store(position + this->mask + 1, std::memory_order_release);
+			return true;
+		}
+
+		// This is only a hint when other threads are using the queue.
+		bool IsEmpty() const
+		{
+			return this->dequeuePosition.load(std::memory_order_relaxed) == this->enqueuePosition.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		struct Cell
+		{
+			std::atomic<uint32_t> sequence;
+			T value;
+		};
+
+		Cell* cellArray;
+		uint32_t mask;
+
+		// The two ends are kept on separate cache lines, so that producers and consumers don't slow each other down.
+		char padding0[64];
+		std::atomic<uint32_t> enqueuePosition;
+		char padding1[64];
+		std::atomic<uint32_t> dequeuePosition;
+		char padding2[64];
+	};
+
+	// This is a bounded queue for when there's only ever one producer thread and one consumer thread.  That
+	// makes it simpler and cheaper than the MPMCQueue.  Neither end ever does anything heavier than an atomic
+	// load or store, and each end keeps a copy of the other's index so it rarely has to touch its cache line.
+	template<typename T>
+	class CHESS_ENGINE_API SPSCQueue
+	{
+	public:
+		// The capacity is rounded up to a power of two.
+		SPSCQueue(uint32_t capacity)
+		{
+			uint32_t size = 2;
+			while (size < capacity)
+				size <<= 1;
+
+			this->mask = size - 1;
+			this->valueArray = new T[size];
+			this->head.store(0, std::memory_order_relaxed);
+			this->tail.store(0, std::memory_order_relaxed);
+			this->cachedHead = 0;
+			this->cachedTail = 0;
+		}
+
+		virtual ~SPSCQueue()
+		{
+			delete[] this->valueArray;
+		}
+
+		// Only the producer may call this.  It returns false if the queue is full.
+		bool TryPush(const T& value)
+		{
+			uint32_t position = this->tail.load(std::memory_order_relaxed);
+			if (position - this->cachedHead > this->mask)
+			{
+				this->cachedHead = this->head.load(std::memory_order_acquire);
+				if (position - this->cachedHead > this->mask)
+					return false;
+			}
+
+			this->valueArray[position & this->mask] = value;
+			this->tail.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Only the consumer may call this.  It returns false if the queue is empty.
+		bool TryPop(T& value)
+		{
+			uint32_t position = this->head.load(std::memory_order_relaxed);
+			if (position == this->cachedTail)
+			{
+				this->cachedTail = this->tail.load(std::memory_order_acquire);
+				if (position == this->cachedTail)
+					return false;
+			}
+
+			value = this->valueArray[position & this->mask];
+			this->head.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+
+		T* valueArray;
+		uint32_t mask;
+
+		// The consumer's end.
+		char padding0[64];
+		std::atomic<uint32_t> head;
+		uint32_t cachedTail;
+
+		// The producer's end.
+		char padding1[64];
+		std::atomic<uint32_t> tail;
+		uint32_t cachedHead;
+		char padding2[64];
 	};
 }
\ No newline at end of file